@@ -1,57 +1,289 @@
+// for MAP_ANONYMOUS and madvise()
+#define _DEFAULT_SOURCE
 #include "arena.h"
 #include "types.h"
+#include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+const char *ArenaKindNames[] = {
+  [AK_RAW] = "raw",
+#define X(name) [AK_##name] = #name,
+  ARENA_KINDS(X)
+#undef X
+};
+
+// count a block in or out of the footprint
+static void arena_account(Arena *arena, ArenaBlock *block, bool add) {
+  uvar size = sizeof(ArenaBlock) + block->alloc;
+  if (!add) {
+    arena->stats.footprint -= size;
+    return;
+  }
+  arena->stats.footprint += size;
+  if (arena->stats.peak < arena->stats.footprint)
+    arena->stats.peak = arena->stats.footprint;
+}
+
+// allocate a block with room for size bytes
+static ArenaBlock *arena_mkblock(uvar size) {
+  ArenaBlock *block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size);
+  if (!block) {
+    fprintf(stderr, "znc: out of memory\n");
+    return NULL;
+  }
+  block->next = NULL;
+  block->used = 0;
+  block->alloc = size;
+  return block;
+}
 
 Arena *arena_init(uvar bsize) {
   if (bsize == 0) return NULL;
   bsize = bsize > ARENA_MINSIZE ? bsize : ARENA_MINSIZE;
 
   // allocate arena
-  Arena *arena = (Arena*)malloc(sizeof(Arena) + bsize);
+  Arena *arena = (Arena*)malloc(sizeof(Arena));
+  if (!arena) {
+    fprintf(stderr, "znc: out of memory\n");
+    return NULL;
+  }
+  arena->head = arena_mkblock(bsize);
+  if (!arena->head) {
+    free(arena);
+    return NULL;
+  }
+
+  // init fields
+  arena->curr = arena->head;
+  arena->big = NULL;
+  arena->bsize = bsize;
+  arena->vmbase = NULL;
+  arena->vmsize = 0;
+  arena->vmstep = 0;
+  memset(&arena->stats, 0, sizeof(ArenaStats));
+  arena_account(arena, arena->head, true);
+  return arena;
+}
+
+// commit pages of the reserved range until the head block has room for
+// size more bytes, returns 0 if succeded
+static int arena_vmgrow(Arena *arena, uvar size) {
+  ArenaBlock *head = arena->head;
+  uvar have = sizeof(ArenaBlock) + head->alloc;
+  if (size > arena->vmsize - sizeof(ArenaBlock) - head->used)
+    return 1;
+
+  uvar want = sizeof(ArenaBlock) + head->used + size;
+  want = (want + arena->vmstep - 1) / arena->vmstep * arena->vmstep;
+  if (want > arena->vmsize)
+    want = arena->vmsize;
+  if (mprotect(arena->vmbase + have, want - have, PROT_READ | PROT_WRITE))
+    return 1;
+
+  head->alloc = want - sizeof(ArenaBlock);
+  arena->stats.footprint += want - have;
+  if (arena->stats.peak < arena->stats.footprint)
+    arena->stats.peak = arena->stats.footprint;
+  return 0;
+}
+
+Arena *arena_initvm(uvar reserve, bool huge) {
+  uvar step = huge ? ARENA_HUGEPAGE : ARENA_VMCOMMIT;
+  if (reserve == 0) reserve = ARENA_VMRESERVE;
+  reserve = (reserve + step - 1) / step * step;
+
+  Arena *arena = (Arena*)malloc(sizeof(Arena));
   if (!arena) {
     fprintf(stderr, "znc: out of memory\n");
     return NULL;
   }
 
+  // reserve only, nothing is backed until it is committed. huge pages
+  // need an aligned range, so reserve one more and trim the ends
+  uvar map = reserve + (huge ? ARENA_HUGEPAGE : 0);
+  char *base = (char*)mmap(NULL, map, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "znc: out of memory\n");
+    free(arena);
+    return NULL;
+  }
+  if (huge) {
+    uvar lead = -(uintptr_t)base & (ARENA_HUGEPAGE - 1);
+    if (lead) munmap(base, lead);
+    if (ARENA_HUGEPAGE - lead) munmap(base + lead + reserve, ARENA_HUGEPAGE - lead);
+    base += lead;
+#ifdef MADV_HUGEPAGE
+    madvise(base, reserve, MADV_HUGEPAGE);
+#endif
+  }
+
+  // the head block lives at the start of the range
+  if (mprotect(base, step, PROT_READ | PROT_WRITE)) {
+    fprintf(stderr, "znc: out of memory\n");
+    munmap(base, reserve);
+    free(arena);
+    return NULL;
+  }
+  ArenaBlock *head = (ArenaBlock*)base;
+  head->next = NULL;
+  head->used = 0;
+  head->alloc = step - sizeof(ArenaBlock);
+
   // init fields
-  arena->next = NULL;
-  arena->used = 0;
-  arena->alloc = bsize;
+  arena->head = head;
+  arena->curr = head;
+  arena->big = NULL;
+  arena->bsize = ARENA_MINSIZE;
+  arena->vmbase = base;
+  arena->vmsize = reserve;
+  arena->vmstep = step;
+  memset(&arena->stats, 0, sizeof(ArenaStats));
+  arena_account(arena, head, true);
   return arena;
 }
 
+// free the dedicated blocks newer than stop
+static void arena_freebig(Arena *arena, ArenaBlock *stop) {
+  ArenaBlock *block = arena->big;
+  while (block != stop) {
+    ArenaBlock *next = block->next;
+    arena_account(arena, block, false);
+    free(block);
+    block = next;
+  }
+  arena->big = stop;
+}
+
 void arena_free(Arena *arena) {
   if (!arena) return;
-  arena_free(arena->next);
-  arena->next = NULL;
-  arena->used = 0;
-  arena->alloc = 0;
+  arena_freebig(arena, NULL);
+  ArenaBlock *block = arena->head;
+  while (block) {
+    ArenaBlock *next = block->next;
+    if ((char*)block != arena->vmbase)
+      free(block);
+    block = next;
+  }
+  if (arena->vmbase)
+    munmap(arena->vmbase, arena->vmsize);
+  arena->head = NULL;
+  arena->curr = NULL;
   free(arena);
 }
 
 void *arena_reqm(Arena *arena, uvar size) {
+  return arena_reqk(arena, size, AK_RAW);
+}
+
+void *arena_reqk(Arena *arena, uvar size, ArenaKind kind) {
   if (!arena || size == 0) return NULL;
-  Arena *block, *tail;
+  arena->stats.requested += size;
+  arena->stats.allocs++;
+  arena->stats.kcnt[kind]++;
+  arena->stats.kbytes[kind] += size;
+
+  // keep the cursor aligned
+  size = (size + ARENA_ALIGN - 1) & ~(uvar)(ARENA_ALIGN - 1);
 
-  // find a suitable block for this allocation
-  block = arena;
-  while (block && block->alloc < block->used + size) {
-    tail = block;
-    block = block->next;
+  // the usual case, bump the current block
+  ArenaBlock *block = arena->curr;
+  if (size <= block->alloc - block->used) {
+    char *mem = (char*)block->data + block->used;
+    block->used += size;
+    return mem;
   }
 
-  // attempt make a new block
-  if (!block) {
-    uvar newsz = tail->alloc;
-    while (newsz < size) newsz *= 2;
-    block = arena_init(newsz);
+  // the reserved range grows in place, big requests included
+  if (block == arena->head && arena->vmbase && !arena_vmgrow(arena, size)) {
+    char *mem = (char*)block->data + block->used;
+    block->used += size;
+    return mem;
+  }
+
+  // big requests get a block of their own, the current one stays
+  if (size > arena->bsize / ARENA_BIGDIV) {
+    block = arena_mkblock(size);
     if (!block) return NULL;
-    tail->next = block;
+    arena_account(arena, block, true);
+    block->next = arena->big;
+    arena->big = block;
+    block->used = size;
+    return block->data;
   }
 
+  // move on to the next block, a free one if there is
+  if (!block->next) {
+    ArenaBlock *tmp = arena_mkblock(arena->bsize);
+    if (!tmp) return NULL;
+    arena_account(arena, tmp, true);
+    block->next = tmp;
+  }
+  block = block->next;
+  arena->curr = block;
+
   // allocate memory
-  char *curr = &block->block[block->used];
-  block->used += size;
-  return curr;
+  block->used = size;
+  return block->data;
+}
+
+ArenaMark arena_mark(Arena *arena) {
+  ArenaMark mark = { NULL, 0, NULL };
+  if (!arena) return mark;
+  mark.curr = arena->curr;
+  mark.used = arena->curr->used;
+  mark.big = arena->big;
+  return mark;
 }
 
+void arena_rewind(Arena *arena, ArenaMark mark) {
+  if (!arena || !mark.curr) return;
+  arena_freebig(arena, mark.big);
+  arena->curr = mark.curr;
+  arena->curr->used = mark.used;
+}
+
+void arena_reset(Arena *arena) {
+  if (!arena) return;
+  arena_freebig(arena, NULL);
+  arena->curr = arena->head;
+  arena->curr->used = 0;
+
+  // a new round of counting, the footprint carries over
+  uvar footprint = arena->stats.footprint;
+  uvar peak = arena->stats.peak;
+  memset(&arena->stats, 0, sizeof(ArenaStats));
+  arena->stats.footprint = footprint;
+  arena->stats.peak = peak;
+}
+
+void arena_stats(Arena *arena, ArenaStats *stats) {
+  if (!arena || !stats) return;
+  *stats = arena->stats;
+  stats->blocks = 0;
+  stats->used = 0;
+  stats->wasted = 0;
+
+  // the tails of the blocks before the current one are never used
+  // again, the blocks after it are free
+  bool passed = false;
+  for (ArenaBlock *block = arena->head; block; block = block->next) {
+    stats->blocks++;
+    if (passed)
+      continue;
+    stats->used += block->used;
+    if (block != arena->curr)
+      stats->wasted += block->alloc - block->used;
+    else
+      passed = true;
+  }
+
+  // dedicated blocks are always full
+  for (ArenaBlock *block = arena->big; block; block = block->next) {
+    stats->blocks++;
+    stats->used += block->used;
+  }
+}
@@ -1,27 +1,129 @@
 #ifndef _ZNC_ARENA_H
 #define _ZNC_ARENA_H
 #include "types.h"
+#include <stdint.h>
+#include <stdbool.h>
 
 #define ARENA_MINSIZE 65536 /* 64kiB */
 
-typedef struct Arena {
-  struct Arena *next;
+// address space reserved by the vm backend, pages are committed as the
+// cursor gets to them
+#ifdef ZN64
+#define ARENA_VMRESERVE ((uvar)1 << 32) /* 4GiB */
+#else
+#define ARENA_VMRESERVE ((uvar)1 << 28) /* 256MiB */
+#endif
+
+// bytes the vm backend commits at once, huge pages commit whole ones
+#define ARENA_VMCOMMIT  262144  /* 256kiB */
+#define ARENA_HUGEPAGE  2097152 /* 2MiB */
+
+// requests bigger than this part of the block size get a block of their
+// own, so they don't waste the tail of the current one
+#define ARENA_BIGDIV 4
+
+// every allocation is aligned for any scalar type
+typedef union {
+  long double ld;
+  double d;
+  uint64_t u;
+  void *p;
+  void (*fn)(void);
+} ArenaAlign;
+#define ARENA_ALIGN sizeof(ArenaAlign)
+
+// node kinds that aaloc() counts apart, the rest is counted as raw
+#define ARENA_KINDS(X) \
+  X(ASTRoot) X(ASTDecl) X(ASTFuncDef) X(ASTFuncArgDef) X(ASTFuncArg) \
+  X(ASTEnum) X(ASTEnumEntry) X(ASTTypeAlias) X(ASTTypeRef) X(ASTBlock) \
+  X(ASTStm) X(ASTExpr) X(ASTArray)
+
+typedef enum {
+  AK_RAW = 0,
+#define X(name) AK_##name,
+  ARENA_KINDS(X)
+#undef X
+  AK_COUNT,
+} ArenaKind;
+
+// printable names of the kinds
+extern const char *ArenaKindNames[];
+
+// allocation counters of an arena, the request counters are cumulative
+// (rewinding does not take them back, a reset does)
+typedef struct {
+  uvar requested;       /* bytes asked for */
+  uvar allocs;          /* number of requests */
+  uvar footprint;       /* bytes held in blocks, headers included */
+  uvar peak;            /* highest footprint */
+  uvar kcnt[AK_COUNT];  /* requests per kind */
+  uvar kbytes[AK_COUNT];/* bytes asked for per kind */
+  // filled by arena_stats()
+  uvar blocks;          /* number of blocks */
+  uvar used;            /* bytes handed out, alignment included */
+  uvar wasted;          /* bytes left at the tails of passed blocks */
+} ArenaStats;
+
+typedef struct ArenaBlock {
+  struct ArenaBlock *next;
   uvar used;
   uvar alloc;
-  char block[];
+  ArenaAlign data[];
+} ArenaBlock;
+
+// the blocks after the current one are free, they are kept by a reset
+// or a rewind and reused before new ones are made
+typedef struct Arena {
+  ArenaBlock *head;     /* first block of the chain */
+  ArenaBlock *curr;     /* block the allocations are bumped from */
+  ArenaBlock *big;      /* dedicated blocks of big requests, newest first */
+  uvar bsize;           /* size of the regular blocks */
+  char *vmbase;         /* range reserved by the vm backend, or NULL */
+  uvar vmsize;          /* size of the reserved range */
+  uvar vmstep;          /* bytes committed at once */
+  ArenaStats stats;     /* allocation counters */
 } Arena;
 
-/* initialize an arena block given block size */
+// a point of the arena to go back to
+typedef struct {
+  ArenaBlock *curr;     /* the current block at the mark */
+  uvar used;            /* its cursor */
+  ArenaBlock *big;      /* the newest dedicated block at the mark */
+} ArenaMark;
+
+/* initialize an arena given block size */
 Arena *arena_init(uvar bsize);
 
+/* initialize an arena over one reserved range of address space (0 for
+   ARENA_VMRESERVE), the head block grows in place as pages are
+   committed. huge asks for transparent huge pages. once the range is
+   full the arena goes on with regular blocks */
+Arena *arena_initvm(uvar reserve, bool huge);
+
 /* free arena */
 void arena_free(Arena *arena);
 
-/* get memory from arena */
+/* get memory from arena, aligned to ARENA_ALIGN */
 void *arena_reqm(Arena *arena, uvar size);
 
+/* get memory from arena, counted as the given kind */
+void *arena_reqk(Arena *arena, uvar size, ArenaKind kind);
+
+/* get the counters of an arena */
+void arena_stats(Arena *arena, ArenaStats *stats);
+
+/* get the current point of the arena */
+ArenaMark arena_mark(Arena *arena);
+
+/* release everything allocated after a mark, the regular blocks are
+   kept for reuse */
+void arena_rewind(Arena *arena, ArenaMark mark);
+
+/* release everything allocated, the regular blocks (and the committed
+   pages of the vm backend) are kept for reuse */
+void arena_reset(Arena *arena);
+
 // just an alias
-#define aaloc(arena, type) (type*)arena_reqm(arena, sizeof(type))
+#define aaloc(arena, type) (type*)arena_reqk(arena, sizeof(type), AK_##type)
 
 #endif // _ZNC_ARENA_H
-
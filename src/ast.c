@@ -5,6 +5,8 @@
 #include "operator.h"
 #include "keyword.h"
 #include "tsys.h"
+#include "number.h"
+#include "strlit.h"
 #include <stdio.h>
 #include <stdbool.h>
 #ifdef _DEBUG
@@ -14,6 +16,101 @@
 // NOTES:
 // - it is not necessary to check the 'lex' and 'arena' ptr
 
+// warn once if an integer literal (maybe negated) does not fit the
+// primitive type it initializes
+static void check_intlit(Lexer *lex, ASTTypeRef *type, ASTExpr *val) {
+  if (type->type != AST_TYPE_PRIMITIVE)
+    return;
+
+  bool neg = false;
+  ASTExpr *lit = val;
+  if (lit->type == AST_EXPR_UNOP && lit->val.unop.isprefix &&
+      lit->val.unop.op == OP_DSH) {
+    neg = true;
+    lit = lit->val.unop.val;
+  }
+  if (lit->type != AST_EXPR_INTEGER)
+    return;
+
+  // magnitude limits, negatives of signed types go one further
+  uint64_t max;
+  switch (type->val.type) {
+    case KWD_BYTE:   max = INT8_MAX;   break;
+    case KWD_SHORT:  max = INT16_MAX;  break;
+    case KWD_INT:    max = INT32_MAX;  break;
+    case KWD_LONG:   max = INT64_MAX;  break;
+    case KWD_UBYTE:  max = UINT8_MAX;  break;
+    case KWD_USHORT: max = UINT16_MAX; break;
+    case KWD_UINT:   max = UINT32_MAX; break;
+    case KWD_ULONG:  max = UINT64_MAX; break;
+    default: return;
+  }
+  bool sign = type->val.type >= KWD_BYTE && type->val.type <= KWD_LONG;
+  if (neg && sign)
+    max++;
+  else if (neg)
+    max = 0;
+
+  ASTInteger *intg = &lit->val.intg;
+  if (!intg->big && intg->val <= max)
+    return;
+  print_loc(lex, val->loc, "warning: integer literal overflows '%s'\n",
+      KeywordNames[type->val.type]);
+}
+
+// enter a nested construct at loc, fails past the nesting limit
+static int parse_enter(Lexer *lex, SrcLoc loc) {
+  if (lex->maxdepth && lex->depth >= lex->maxdepth) {
+    print_loc(lex, loc, "syntax error: nesting exceeds the limit of %lu levels\n",
+        (unsigned long)lex->maxdepth);
+    return 1;
+  }
+  lex->depth++;
+  return 0;
+}
+
+// enter a nested construct the parser recurses into, these are bound by
+// LEXER_MAXRECURSE even when the nesting limit is higher or none
+static int parse_recurse(Lexer *lex, SrcLoc loc) {
+  if (lex->rdepth >= LEXER_MAXRECURSE) {
+    print_loc(lex, loc, "syntax error: nesting exceeds the limit of %lu levels\n",
+        (unsigned long)LEXER_MAXRECURSE);
+    return 1;
+  }
+  if (parse_enter(lex, loc)) return 1;
+  lex->rdepth++;
+  return 0;
+}
+
+// leave a construct entered with parse_recurse()
+static void parse_return(Lexer *lex) {
+  lex->depth--;
+  lex->rdepth--;
+}
+
+ParseCheckpoint parse_checkpoint(Lexer *lex, Arena *arena) {
+  ParseCheckpoint cp;
+  cp.pind = lex->pind;
+  cp.depth = lex->depth;
+  cp.rdepth = lex->rdepth;
+  cp.mark = arena_mark(arena);
+  lex->mute++;
+  return cp;
+}
+
+void parse_rollback(Lexer *lex, Arena *arena, ParseCheckpoint *cp) {
+  lex->pind = cp->pind;
+  lex->depth = cp->depth;
+  lex->rdepth = cp->rdepth;
+  arena_rewind(arena, cp->mark);
+  lex->mute--;
+}
+
+void parse_commit(Lexer *lex, ParseCheckpoint *cp) {
+  (void)cp;
+  lex->mute--;
+}
+
 ASTExpr *parse_identifier(Lexer *lex, Arena *arena) {
   ASTExpr *node = aaloc(arena, ASTExpr);
   if (!node) return NULL;
@@ -23,14 +120,14 @@ ASTExpr *parse_identifier(Lexer *lex, Arena *arena) {
   if (!tok)
     return NULL;
 
-  if (expect_token(tok, TOKEN_IDENTIFIER, NULL))
+  if (expect_token(lex, tok, TOKEN_IDENTIFIER, 0))
     return NULL;
 
   // set some fields
-  node->tok = tok;
+  node->loc = tokloc(lex, tok);
   node->type = AST_EXPR_IDENTIFIER;
-  node->val.ident.name = tok->lexeme;
-  node->val.ident.len = tok->len;
+  node->val.ident.name = toktext(lex, tok);
+  node->val.ident.len = lexer_toklen(lex, tok);
 
   return node;
 }
@@ -42,47 +139,49 @@ ASTExpr *parse_expr(Lexer *lex, Arena *arena) {
 ASTExpr *parse_infix(Lexer *lex, Arena *arena, ASTExpr *lhs, int minprec) {
   if (!lhs) return NULL;
 
-  // ensure the left hand side is processed
-  if (minprec > OP_HIGHEST_PREC) return lhs;
-  lhs = parse_infix(lex, arena, lhs, minprec + 1);
-  if (!lhs) return NULL;
-
-  // get next token
-  Token *next = lexer_peek(lex, 1);
-  if (!next) return NULL;
-
-  // while token
-  while (next->type == TOKEN_OPERATOR && getprec(getop(next->lexeme)) >= minprec) {
-    lexer_consume(lex);
-    Token *optok = next;
-    OperatorType op = getop(next->lexeme);
-
-    // process right hand side operand
-    ASTExpr *rhs = parse_factor(lex, arena);
-    if (!rhs) return NULL;
+  // operators still waiting for their right operand, innermost first and
+  // linked through their rhs. a new operator first completes the waiting
+  // ones that do not take it in their right operand, so runs of any
+  // length (even right-associative ones) need no recursion
+  ASTExpr *top = NULL;
 
-    // process higher-precedence tokens
-    next = lexer_peek(lex, 1);
+  for (;;) {
+    Token *next = lexer_peek(lex, 1);
     if (!next) return NULL;
-    while (next->type == TOKEN_OPERATOR && getprec(getop(next->lexeme)) > minprec) {
-      rhs = parse_infix(lex, arena, rhs, minprec + 1);
-      next = lexer_peek(lex, 1);
-     if (!next) return NULL;
+    if (next->type != TOKEN_OPERATOR) break;
+    OpBind bind = OpBindTable[next->sub];
+    if (!bind.lbp || bind.lbp < minprec) break;
+
+    // lhs is the right operand of the ones that bind tighter
+    while (top && bind.lbp < OpBindTable[top->val.binop.op].rbp) {
+      ASTExpr *up = top->val.binop.rhs;
+      top->val.binop.rhs = lhs;
+      lhs = top;
+      top = up;
     }
+    lexer_consume(lex);
 
-    // new expr
+    // new expr, waiting for its right hand side operand
     ASTExpr *node = aaloc(arena, ASTExpr);
     if (!node) return NULL;
-    node->tok = optok;
+    node->loc = tokloc(lex, next);
     node->type = AST_EXPR_BINOP;
     node->val.binop.lhs = lhs;
-    node->val.binop.op = op;
-    node->val.binop.rhs = rhs;
-    lhs = node;
+    node->val.binop.op = next->sub;
+    node->val.binop.rhs = top;
+    top = node;
 
-    next = lexer_peek(lex, 1);
-    if (!next) return NULL;
- }
+    lhs = parse_factor(lex, arena);
+    if (!lhs) return NULL;
+  }
+
+  // complete the rest
+  while (top) {
+    ASTExpr *up = top->val.binop.rhs;
+    top->val.binop.rhs = lhs;
+    lhs = top;
+    top = up;
+  }
 
   return lhs;
 }
@@ -92,90 +191,100 @@ ASTExpr *parse_factor(Lexer *lex, Arena *arena) {
   if (!next)
     return NULL;
 
+  // every nested expression passes through here
+  if (parse_recurse(lex, tokloc(lex, next))) return NULL;
+
   // hierarchy:
   //   a b C d e   ->   (a(b(((C)d)e)))
   //   d -> e -> b -> a
   // unary precedence rules apply:
   //   right -> right-most -> left -> left-most
+  //
+  // a prefix operator and the false branch of a ternary take the whole
+  // factor that follows, instead of recursing into it the new node is
+  // put into the hole and the loop goes on to fill its operand
+  ASTExpr *root = NULL;
+  ASTExpr **hole = &root;
+
+  for (;;) {
+    next = lexer_peek(lex, 1);
+    if (!next) return NULL;
 
-  // prefix unary operators
-  if (next->type == TOKEN_OPERATOR && op_isprefix(getop(next->lexeme))) {
-    lexer_consume(lex);
-
-    // make a new node containing the unary op
-    ASTExpr *expr = aaloc(arena, ASTExpr);
-    if (!expr) return NULL;
-    expr->tok = next;
-    expr->type = AST_EXPR_UNOP;
-    expr->val.unop.op = getop(next->lexeme);
-    expr->val.unop.isprefix = true;
-
-    // process node value
-    ASTExpr *sub = parse_factor(lex, arena);
-    if (!sub) return NULL;
-    expr->val.unop.val = sub;
-
-    return expr;
-  }
-
-  // process primary
-  ASTExpr *expr = parse_primary(lex, arena);
-  if (!expr) return NULL;
-  next = lexer_peek(lex, 1);
-  if (!next) return NULL;
+    // prefix unary operators
+    if (next->type == TOKEN_OPERATOR && op_isprefix(next->sub)) {
+      lexer_consume(lex);
 
-  // while there's still postfix ops...
-  while (next->type == TOKEN_OPERATOR && op_ispostfix(getop(next->lexeme))) {
-    lexer_consume(lex);
+      // make a new node containing the unary op
+      ASTExpr *expr = aaloc(arena, ASTExpr);
+      if (!expr) return NULL;
+      expr->loc = tokloc(lex, next);
+      expr->type = AST_EXPR_UNOP;
+      expr->val.unop.op = next->sub;
+      expr->val.unop.isprefix = true;
+
+      // its value is the rest of the factor
+      *hole = expr;
+      hole = &expr->val.unop.val;
+      continue;
+    }
 
-    // new node
-    ASTExpr *node = aaloc(arena, ASTExpr);
-    if (!node) return NULL;
-    node->tok = next;
-    node->type = AST_EXPR_UNOP;
-    node->val.unop.op = getop(next->lexeme);
-    node->val.unop.isprefix = false;
-    node->val.unop.val = expr;
-    expr = node;
-
-    // for possible subsequent postfix ops
+    // process primary
+    ASTExpr *expr = parse_primary(lex, arena);
+    if (!expr) return NULL;
     next = lexer_peek(lex, 1);
     if (!next) return NULL;
-  }
 
-  // check ternary
-  if (cmp_token(next, TOKEN_OPERATOR, "?")) {
+    // while there's still postfix ops...
+    while (next->type == TOKEN_OPERATOR && op_ispostfix(next->sub)) {
+      lexer_consume(lex);
+
+      // new node
+      ASTExpr *node = aaloc(arena, ASTExpr);
+      if (!node) return NULL;
+      node->loc = tokloc(lex, next);
+      node->type = AST_EXPR_UNOP;
+      node->val.unop.op = next->sub;
+      node->val.unop.isprefix = false;
+      node->val.unop.val = expr;
+      expr = node;
+
+      // for possible subsequent postfix ops
+      next = lexer_peek(lex, 1);
+      if (!next) return NULL;
+    }
+
+    // the factor ends here, unless this is a ternary
+    if (!cmp_token(next, TOKEN_OPERATOR, OP_QST)) {
+      *hole = expr;
+      break;
+    }
     lexer_consume(lex); // consume '?'
 
     ASTExpr *node = aaloc(arena, ASTExpr);
     if (!node) return NULL;
-    node->tok = next;
+    node->loc = tokloc(lex, next);
     node->type = AST_EXPR_TERNOP;
     node->val.ternop.op = OP_QST;
     node->val.ternop.lch = expr;
 
-    ASTExpr *sub = NULL;
-
     // true expression
-    sub = parse_factor(lex, arena);
+    ASTExpr *sub = parse_factor(lex, arena);
     if (!sub) return NULL;
     node->val.ternop.mch = sub;
 
     // consume colon
     next = lexer_consume(lex);
     if (!next) return NULL;
-    if (expect_token(next, TOKEN_OPERATOR, ":"))
+    if (expect_token(lex, next, TOKEN_OPERATOR, OP_CLN))
       return NULL;
 
-    // false expression
-    sub = parse_factor(lex, arena);
-    if (!sub) return NULL;
-    node->val.ternop.rch = sub;
-
-    expr = node;
+    // the false expression is the rest of the factor
+    *hole = node;
+    hole = &node->val.ternop.rch;
   }
 
-  return expr;
+  parse_return(lex);
+  return root;
 }
 
 ASTExpr *parse_primary(Lexer *lex, Arena *arena) {
@@ -192,20 +301,39 @@ ASTExpr *parse_primary(Lexer *lex, Arena *arena) {
     lexer_consume(lex);
     ASTExpr *node = aaloc(arena, ASTExpr);
     if (!node) return NULL;
-    node->tok = next;
+    node->loc = tokloc(lex, next);
     node->type = AST_EXPR_STRING;
-    node->val.str.raw = next->lexeme;
-    node->val.str.len = next->len;
+    ASTString *str = &node->val.str;
+    str->raw = toktext(lex, next);
+    str->len = lexer_toklen(lex, next);
+
+    // decode the escapes once
+    uvar err = 0;
+    switch (str_decode(str->raw, str->len, arena, &str->val, &str->vlen, &err)) {
+      case STR_OK:
+        break;
+      case STR_BADESC: {
+        print_span(lex, node->loc + err, 2, "syntax error: invalid escape sequence\n");
+        return NULL;
+      }
+      case STR_BADUTF8: {
+        print_span(lex, node->loc + err, 1, "syntax error: invalid utf-8 in string literal\n");
+        return NULL;
+      }
+      default:
+        return NULL;
+    }
     return parse_secondary(lex, arena, node);
   }
 
   // array literals
-  if (cmp_token(next, TOKEN_BRACKET, "[")) {
+  if (cmp_token(next, TOKEN_BRACKET, PUNC_LSQUARE)) {
     lexer_consume(lex); // consume '['
     ASTExpr *expr = aaloc(arena, ASTExpr);
     if (!expr) return NULL;
-    expr->tok = next;
+    expr->loc = tokloc(lex, next);
     expr->type = AST_EXPR_ARRAY;
+    expr->val.arr = NULL;
     ASTArray *arr = NULL;
 
     while (1) {
@@ -213,7 +341,7 @@ ASTExpr *parse_primary(Lexer *lex, Arena *arena) {
       if (!next) return NULL;
 
       // maybe end?
-      if (cmp_token(next, TOKEN_BRACKET, "]"))
+      if (cmp_token(next, TOKEN_BRACKET, PUNC_RSQUARE))
         break;
 
       // create a new element
@@ -234,50 +362,75 @@ ASTExpr *parse_primary(Lexer *lex, Arena *arena) {
       next = lexer_peek(lex, 1);
       if (!next) return NULL;
       if (
-        !cmp_token(next, TOKEN_BRACKET, "]") &&
-        !cmp_token(next, TOKEN_OPERATOR, ",")
+        !cmp_token(next, TOKEN_BRACKET, PUNC_RSQUARE) &&
+        !cmp_token(next, TOKEN_OPERATOR, OP_CMM)
       ) {
-        print_token(next, "syntax error: expected either of ']' and ','\n");
+        print_token(lex, next, "syntax error: expected either of ']' and ','\n");
         return NULL;
       }
 
       // consume if this is a comma
-      if (cmp_token(next, TOKEN_OPERATOR, ","))
+      if (cmp_token(next, TOKEN_OPERATOR, OP_CMM))
         lexer_consume(lex);
     }
 
     // end ']'
     next = lexer_consume(lex);
-    if (expect_token(next, TOKEN_BRACKET, "]")) return NULL;
+    if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RSQUARE)) return NULL;
     return parse_secondary(lex, arena, expr);
   }
 
   // integers
-  if (cmp_token(next, TOKEN_INTEGER, NULL)) {
+  if (cmp_token(next, TOKEN_INTEGER, 0)) {
     lexer_consume(lex); // consume the int
     ASTExpr *val = aaloc(arena, ASTExpr);
     if (!val) return NULL;
-    val->tok = next;
+    val->loc = tokloc(lex, next);
     val->type = AST_EXPR_INTEGER;
-    val->val.intg.text = next->lexeme;
-    val->val.intg.len = next->len;
+    ASTInteger *intg = &val->val.intg;
+    intg->text = toktext(lex, next);
+    intg->len = lexer_toklen(lex, next);
+    intg->val = 0;
+    intg->big = NULL;
+    intg->nbig = 0;
+    // too big for 64 bits, keep all of it
+    if (num_int(intg->text, intg->len, next->sub, &intg->val)) {
+      intg->big = (uint32_t*)arena_reqm(arena,
+          sizeof(uint32_t) * num_intlimbs(intg->len, next->sub));
+      if (!intg->big) return NULL;
+      intg->nbig = num_intbig(intg->text, intg->len, next->sub, intg->big);
+      intg->val = UINT64_MAX;
+    }
+    return parse_secondary(lex, arena, val);
+  }
+
+  // floats
+  if (cmp_token(next, TOKEN_FLOAT, 0)) {
+    lexer_consume(lex); // consume the float
+    ASTExpr *val = aaloc(arena, ASTExpr);
+    if (!val) return NULL;
+    val->loc = tokloc(lex, next);
+    val->type = AST_EXPR_FLOAT;
+    val->val.flt.text = toktext(lex, next);
+    val->val.flt.len = lexer_toklen(lex, next);
+    val->val.flt.val = num_float(val->val.flt.text, val->val.flt.len);
     return parse_secondary(lex, arena, val);
   }
 
   // type cast
-  if (cmp_token(next, TOKEN_OPERATOR, "<")) {
-    Token *tok = next;
+  if (cmp_token(next, TOKEN_OPERATOR, OP_LES)) {
+    SrcLoc loc = tokloc(lex, next);
     lexer_consume(lex); // consume '<'
     ASTTypeRef *type = parse_typeref(lex, arena);
     if (!type) return NULL;
     next = lexer_consume(lex); // consume '>'
-    if (expect_token(next, TOKEN_OPERATOR, ">")) return NULL;
+    if (expect_token(lex, next, TOKEN_OPERATOR, OP_GRT)) return NULL;
     ASTExpr *val = parse_factor(lex, arena);
     if (!val) return NULL;
     // setup type cast node
     ASTExpr *node = aaloc(arena, ASTExpr);
     if (!node) return NULL;
-    node->tok = tok;
+    node->loc = loc;
     node->type = AST_EXPR_CAST;
     node->val.cast.type = type;
     node->val.cast.val = val;
@@ -285,17 +438,17 @@ ASTExpr *parse_primary(Lexer *lex, Arena *arena) {
   }
 
   // expression enclosed with paren
-  if (cmp_token(next, TOKEN_BRACKET, "(")) {
+  if (cmp_token(next, TOKEN_BRACKET, PUNC_LPAREN)) {
     lexer_consume(lex);
     ASTExpr *expr = parse_expr(lex, arena);
     if (!expr) return NULL;
     next = lexer_consume(lex);
     if (!next) return NULL;
-    if (expect_token(next, TOKEN_BRACKET, ")")) return NULL;
+    if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RPAREN)) return NULL;
     return parse_secondary(lex, arena, expr);
   }
 
-  expect_token(next, -1, NULL);
+  expect_token(lex, next, -1, 0);
   return NULL;
 }
 
@@ -306,363 +459,520 @@ ASTExpr *parse_secondary(Lexer *lex, Arena *arena, ASTExpr *lhs) {
   if (!next)
     return NULL;
 
-  // check whether this is a member-access or subscript op,
-  // or a function call
-  if (
-    !cmp_token(next, TOKEN_OPERATOR, ".") &&
-    !cmp_token(next, TOKEN_BRACKET, "[") &&
-    !cmp_token(next, TOKEN_BRACKET, "(")
-  ) return lhs;
+  // member-access, subscript and function calls chain in any order, each
+  // one wraps lhs
+  for (;;) {
+    if (
+      !cmp_token(next, TOKEN_OPERATOR, OP_DOT) &&
+      !cmp_token(next, TOKEN_BRACKET, PUNC_LSQUARE) &&
+      !cmp_token(next, TOKEN_BRACKET, PUNC_LPAREN)
+    ) return lhs;
 
-  // check member-access
-  while (cmp_token(next, TOKEN_OPERATOR, ".")) {
-    lexer_consume(lex); // consume '.'
+    // check member-access
+    while (cmp_token(next, TOKEN_OPERATOR, OP_DOT)) {
+      lexer_consume(lex); // consume '.'
 
-    ASTExpr *node = aaloc(arena, ASTExpr);
-    if (!node) return NULL;
-    node->tok = next;
-    node->type = AST_EXPR_BINOP;
-    node->val.binop.op = OP_DOT;
-    node->val.binop.lhs = lhs;
+      ASTExpr *node = aaloc(arena, ASTExpr);
+      if (!node) return NULL;
+      node->loc = tokloc(lex, next);
+      node->type = AST_EXPR_BINOP;
+      node->val.binop.op = OP_DOT;
+      node->val.binop.lhs = lhs;
 
-    // the member name
-    ASTExpr *memb = parse_identifier(lex, arena);
-    if (!memb) return NULL;
-    node->val.binop.rhs = memb;
+      // the member name
+      ASTExpr *memb = parse_identifier(lex, arena);
+      if (!memb) return NULL;
+      node->val.binop.rhs = memb;
 
-    lhs = node;
+      lhs = node;
 
-    next = lexer_peek(lex, 1);
-    if (!next) return NULL;
-  }
+      next = lexer_peek(lex, 1);
+      if (!next) return NULL;
+    }
 
-  // check subscript
-  while (cmp_token(next, TOKEN_BRACKET, "[")) {
-    lexer_consume(lex); // consume '['
+    // check subscript
+    while (cmp_token(next, TOKEN_BRACKET, PUNC_LSQUARE)) {
+      lexer_consume(lex); // consume '['
 
-    ASTExpr *node = aaloc(arena, ASTExpr);
-    if (!node) return NULL;
-    node->tok = next;
-    node->type = AST_EXPR_BINOP;
-    node->val.binop.op = OP_SBC;
-    node->val.binop.lhs = lhs;
+      ASTExpr *node = aaloc(arena, ASTExpr);
+      if (!node) return NULL;
+      node->loc = tokloc(lex, next);
+      node->type = AST_EXPR_BINOP;
+      node->val.binop.op = OP_SBC;
+      node->val.binop.lhs = lhs;
+
+      // the key
+      ASTExpr *sub = parse_expr(lex, arena);
+      if (!sub) return NULL;
+      node->val.binop.rhs = sub;
+
+      // consume ']'
+      next = lexer_consume(lex);
+      if (!next) return NULL;
+      if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RSQUARE))
+        return NULL;
 
-    // the key
-    ASTExpr *sub = parse_expr(lex, arena);
-    if (!sub) return NULL;
-    node->val.binop.rhs = sub;
+      lhs = node;
 
-    // consume ']'
-    next = lexer_consume(lex);
-    if (!next) return NULL;
-    if (expect_token(next, TOKEN_BRACKET, "]"))
-      return NULL;
+      next = lexer_peek(lex, 1);
+      if (!next) return NULL;
+    }
 
-    lhs = node;
+    // check function calls
+    while (cmp_token(next, TOKEN_BRACKET, PUNC_LPAREN)) {
+      lexer_consume(lex); // consume '('
 
-    next = lexer_peek(lex, 1);
-    if (!next) return NULL;
-  }
+      ASTExpr *node = aaloc(arena, ASTExpr);
+      if (!node) return NULL;
+      node->loc = tokloc(lex, next);
+      node->type = AST_EXPR_CALL;
+      node->val.fcall.fname = lhs;
+      node->val.fcall.args = NULL;
+      ASTFuncArg *curr = NULL;
 
-  // check function calls
-  while (cmp_token(next, TOKEN_BRACKET, "(")) {
-    lexer_consume(lex); // consume '('
+      next = lexer_peek(lex, 1);
+      if (!next) return NULL;
 
-    ASTExpr *node = aaloc(arena, ASTExpr);
-    if (!node) return NULL;
-    node->tok = next;
-    node->type = AST_EXPR_CALL;
-    node->val.fcall.fname = lhs;
-    ASTFuncArg *curr = NULL;
+      // the args
+      while (!cmp_token(next, TOKEN_BRACKET, PUNC_RPAREN)) {
+        // initialize arg
+        ASTFuncArg *arg = aaloc(arena, ASTFuncArg);
+        if (!arg) return NULL;
+        arg->next = NULL;
+        arg->target = NULL;
+        arg->tlen = 0;
+
+        // kwarg?
+        if (cmp_token(next, TOKEN_IDENTIFIER, 0)) {
+          // peeking further may move the tokens, next is fetched again
+          uvar end = next->pos + lexer_toklen(lex, next);
+          Token *eql = lexer_peek(lex, 2);
+          next = lexer_peek(lex, 1);
+          // the id should be close to the equal sign to consider it as a kwarg
+          if (cmp_token(eql, TOKEN_OPERATOR, OP_EQL) && eql->pos == end) {
+            arg->target = toktext(lex, next);
+            arg->tlen = lexer_toklen(lex, next);
+            lexer_consume(lex); // consume id
+            lexer_consume(lex); // consume '='
+          }
+        }
 
-    next = lexer_peek(lex, 1);
-    if (!next) return NULL;
+        // process arg expression
+        ASTExpr *val = parse_infix(lex, arena, parse_factor(lex, arena), 2);
+        if (!val) return NULL;
+        arg->val = val;
 
-    // the args
-    while (!cmp_token(next, TOKEN_BRACKET, ")")) {
-      // initialize arg
-      ASTFuncArg *arg = aaloc(arena, ASTFuncArg);
-      if (!arg) return NULL;
-      arg->target = NULL;
-      arg->tlen = 0;
+        if (curr) curr->next = arg;
+        else node->val.fcall.args = arg;
+        curr = arg;
 
-      // kwarg?
-      if (
-        cmp_token(next, TOKEN_IDENTIFIER, NULL) &&
-        cmp_token(lexer_peek(lex, 2), TOKEN_OPERATOR, "=") &&
-        lexer_peek(lex, 2)->pos == next->pos + next->len
-        // the id should be close to the equal sign to consider it as a kwarg
-      ) {
-        lexer_consume(lex); // consume id
-        lexer_consume(lex); // consume '='
-        arg->target = next->lexeme;
-        arg->tlen = next->len;
+        // peek next token
+        next = lexer_peek(lex, 1);
+        if (!next) return NULL;
+
+        // next arg
+        if (cmp_token(next, TOKEN_OPERATOR, OP_CMM)) {
+          lexer_consume(lex);
+          next = lexer_peek(lex, 1);
+          if (!next) return NULL;
+
+          // ')' after ',' ??
+          if (cmp_token(next, TOKEN_BRACKET, PUNC_RPAREN)) {
+            expect_token(lex, next, -1, 0);
+            return NULL;
+          }
+
+          continue;
+        }
+
+        // found end
+        if (cmp_token(next, TOKEN_BRACKET, PUNC_RPAREN))
+          break;
       }
 
-      // process arg expression
-      ASTExpr *val = parse_infix(lex, arena, parse_factor(lex, arena), 2);
-      if (!val) return NULL;
-      arg->val = val;
+      // consume ')'
+      next = lexer_consume(lex);
+      if (!next) return NULL;
+      if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RPAREN))
+        return NULL;
 
-      if (curr) curr->next = arg;
-      else node->val.fcall.args = arg;
-      curr = arg;
+      lhs = node;
 
-      // peek next token
       next = lexer_peek(lex, 1);
       if (!next) return NULL;
+    }
+  }
+}
 
-      // next arg
-      if (cmp_token(next, TOKEN_OPERATOR, ",")) {
-        lexer_consume(lex);
-        next = lexer_peek(lex, 1);
-        if (!next) return NULL;
+// whether tok starts a top-level declaration
+static bool parse_isdecl(Token *tok) {
+  return cmp_token(tok, TOKEN_KEYWORD, KWD_FUNCTION) ||
+         cmp_token(tok, TOKEN_KEYWORD, KWD_ENUM) ||
+         cmp_token(tok, TOKEN_KEYWORD, KWD_TYPE);
+}
 
-        // ')' after ',' ??
-        if (cmp_token(next, TOKEN_BRACKET, ")")) {
-          expect_token(next, -1, NULL);
-          return NULL;
-        }
+// count a syntax error, returns 1 once there are too many of them
+static int parse_error(Lexer *lex) {
+  lex->nerrs++;
+  if (!lex->maxerrs || lex->nerrs < lex->maxerrs)
+    return 0;
+  print_loc(lex, SRCLOC_NONE, "too many errors, stopping\n");
+  return 1;
+}
 
-        continue;
-      }
+// whether the error limit has been reached
+#define parse_stopped(lex) ((lex)->maxerrs && (lex)->nerrs >= (lex)->maxerrs)
+
+// skip the rest of a broken statement that started at token start: stop
+// after a ';' or a whole block, or before a '}' that ends the enclosing
+// block, a declaration keyword or the end of input. returns the token it
+// stopped at
+static Token *parse_sync(Lexer *lex, uvar start) {
+  // the token the error was found at may belong to the code around, or
+  // open a block of the broken statement
+  uvar depth = 0;
+  if (lex->pind > start) {
+    Token *prev = lexer_peek(lex, 0);
+    if (cmp_token(prev, TOKEN_DELIMETER, PUNC_SEMI))
+      return lexer_peek(lex, 1);
+    if (cmp_token(prev, TOKEN_BRACKET, PUNC_RBRACE) || parse_isdecl(prev))
+      lex->pind--;
+    else if (cmp_token(prev, TOKEN_BRACKET, PUNC_LBRACE))
+      depth++;
+  }
 
-      // found end
-      if (cmp_token(next, TOKEN_BRACKET, ")"))
-        break;
+  for (;;) {
+    Token *tok = lexer_peek(lex, 1);
+    if (!tok || tok->type == TOKEN_EOF || tok->type == TOKEN_ERROR || parse_isdecl(tok))
+      return tok;
+    if (cmp_token(tok, TOKEN_BRACKET, PUNC_RBRACE)) {
+      if (!depth)
+        return tok;
+      lexer_consume(lex);
+      if (!--depth)
+        return lexer_peek(lex, 1);
+      continue;
     }
+    lexer_consume(lex);
+    if (cmp_token(tok, TOKEN_BRACKET, PUNC_LBRACE))
+      depth++;
+    else if (!depth && cmp_token(tok, TOKEN_DELIMETER, PUNC_SEMI))
+      return lexer_peek(lex, 1);
+  }
+}
 
-    // consume ')'
-    next = lexer_consume(lex);
-    if (!next) return NULL;
-    if (expect_token(next, TOKEN_BRACKET, ")"))
-      return NULL;
-
-    lhs = node;
+// count the error of a statement that started at token start and skip
+// it, returns 0 if the next statement can be parsed
+static int parse_recover(Lexer *lex, uvar start) {
+  if (lex->mute || parse_error(lex))
+    return 1;
+  Token *tok = parse_sync(lex, start);
+  return !tok || tok->type == TOKEN_EOF || tok->type == TOKEN_ERROR || parse_isdecl(tok);
+}
 
-    next = lexer_peek(lex, 1);
-    if (!next) return NULL;
+// an 'if' or a block whose nested statements are being parsed
+typedef struct ParseFrame {
+  struct ParseFrame *next;
+  ASTStm *stm;
+} ParseFrame;
+
+typedef struct {
+  ParseFrame *top;      /* innermost open statement */
+  ParseFrame *spare;    /* popped frames, for reuse */
+} ParseStack;
+
+// open a statement that has nested ones, returns 0 if succeded
+static int parse_push(Lexer *lex, Arena *arena, ParseStack *stk, ASTStm *stm) {
+  if (parse_enter(lex, stm->loc)) return 1;
+  ParseFrame *frame = stk->spare;
+  if (frame)
+    stk->spare = frame->next;
+  else {
+    frame = (ParseFrame*)arena_reqm(arena, sizeof(ParseFrame));
+    if (!frame) return 1;
   }
+  frame->stm = stm;
+  frame->next = stk->top;
+  stk->top = frame;
+  return 0;
+}
 
-  return parse_secondary(lex, arena, lhs);
+static void parse_pop(Lexer *lex, ParseStack *stk) {
+  ParseFrame *frame = stk->top;
+  stk->top = frame->next;
+  frame->next = stk->spare;
+  stk->spare = frame;
+  lex->depth--;
 }
 
-ASTStm *parse_statement(Lexer *lex, Arena *arena) {
-  Token *next = lexer_peek(lex, 1);
-  if (!next) return NULL;
-  ASTStm *stm = aaloc(arena, ASTStm);
-  if (!stm) return NULL;
-  stm->next = NULL; // used on blocks
+// nested statements are parsed in a loop over an explicit stack, so the
+// nesting is only limited by memory (and lex->maxdepth). a statement that
+// is the last part of another one ('while' and 'else' bodies) just fills
+// the hole left for it, only an 'if' before its 'else' and an unclosed
+// block need a frame on the stack
+static ASTStm *parse_stmloop(Lexer *lex, Arena *arena) {
+  ParseStack stk = { NULL, NULL };
+  ASTStm *root = NULL;
+  ASTStm **hole = &root;      // where the next statement goes
+  uvar depth = lex->depth;
+  uvar rdepth = lex->rdepth;
+
+  for (;;) {
+    Token *next = lexer_peek(lex, 1);
+    if (!next) return NULL;
+    uvar start = lex->pind;
+    ASTStm *stm = aaloc(arena, ASTStm);
+    if (!stm) return NULL;
+    stm->next = NULL; // used on blocks
+    stm->loc = tokloc(lex, next);
+    *hole = stm;
 
-  if (next->type == TOKEN_KEYWORD) {
-    lexer_consume(lex); // consume the keyword
-    KeywordType kwd = getkwd(next->lexeme);
+    if (next->type == TOKEN_KEYWORD) {
+      lexer_consume(lex); // consume the keyword
+      KeywordType kwd = next->sub;
 
-    switch (kwd) {
-      case KWD_LET: {
-        stm->type = AST_STM_LET;
+      switch (kwd) {
+        case KWD_LET: {
+          stm->type = AST_STM_LET;
 
-        // process type
-        ASTTypeRef *type = parse_typeref(lex, arena);
-        if (!type) return NULL;
-        stm->val.let.type = type;
+          // process type
+          ASTTypeRef *type = parse_typeref(lex, arena);
+          if (!type) goto fail;
+          stm->val.let.type = type;
 
-        // get identifier
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        if (expect_token(next, TOKEN_IDENTIFIER, NULL))
-          return NULL;
-        stm->tok = next;
-        stm->val.let.name = next->lexeme;
-        stm->val.let.nlen = next->len;
-
-        // check whether there is initial value
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        stm->val.let.initval = NULL;
+          // get identifier
+          next = lexer_consume(lex);
+          if (!next) return NULL;
+          if (expect_token(lex, next, TOKEN_IDENTIFIER, 0))
+            goto fail;
+          stm->loc = tokloc(lex, next);
+          stm->val.let.name = toktext(lex, next);
+          stm->val.let.nlen = lexer_toklen(lex, next);
 
-        if (cmp_token(next, TOKEN_OPERATOR, "=")) {
-          ASTExpr *initval = parse_expr(lex, arena);
-          if (!initval) return NULL;
-          stm->val.let.initval = initval;
+          // check whether there is initial value
           next = lexer_consume(lex);
           if (!next) return NULL;
+          stm->val.let.initval = NULL;
+
+          if (cmp_token(next, TOKEN_OPERATOR, OP_EQL)) {
+            ASTExpr *initval = parse_expr(lex, arena);
+            if (!initval) goto fail;
+            check_intlit(lex, type, initval);
+            stm->val.let.initval = initval;
+            next = lexer_consume(lex);
+            if (!next) return NULL;
+          }
+
+          // expect semi-colon
+          if (expect_token(lex, next, TOKEN_DELIMETER, PUNC_SEMI))
+            goto fail;
+          break;
         }
 
-        // expect semi-colon
-        if (expect_token(next, TOKEN_DELIMETER, ";"))
-          return NULL;
-        return stm;
-      }
+        case KWD_IF: {
+          stm->type = AST_STM_IFELSE;
+          stm->loc = tokloc(lex, next);
 
-      case KWD_IF: {
-        stm->type = AST_STM_IFELSE;
-        stm->tok = next;
+          // expect condition opening '('
+          next = lexer_consume(lex);
+          if (!next) return NULL;
+          if (expect_token(lex, next, TOKEN_BRACKET, PUNC_LPAREN))
+            goto fail;
 
-        // expect condition opening '('
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        if (expect_token(next, TOKEN_BRACKET, "("))
-          return NULL;
+          ASTExpr *cond = parse_expr(lex, arena);
+          if (!cond) goto fail;
+          stm->val.ifels.cond = cond;
 
-        ASTExpr *cond = parse_expr(lex, arena);
-        if (!cond) return NULL;
-        stm->val.ifels.cond = cond;
+          // expect condition closing ')'
+          next = lexer_consume(lex);
+          if (!next) return NULL;
+          if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RPAREN))
+            goto fail;
+
+          // now the code to execute, the else statement is looked for
+          // once it is done
+          stm->val.ifels.code = NULL;
+          stm->val.ifels.elsec = NULL;
+          if (parse_push(lex, arena, &stk, stm))
+            goto fail;
+          hole = &stm->val.ifels.code;
+          continue;
+        }
 
-        // expect condition closing ')'
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        if (expect_token(next, TOKEN_BRACKET, ")"))
-          return NULL;
+        case KWD_ELSE: {
+          print_token(lex, next, "syntax error: the 'else' statement must be preceded by an 'if' statement\n");
+          goto fail;
+        }
 
-        // now the code to execute
-        ASTStm *code = parse_statement(lex, arena);
-        if (!code) return NULL;
-        stm->val.ifels.code = code;
+        case KWD_WHILE: {
+          stm->type = AST_STM_WHILE;
+          stm->loc = tokloc(lex, next);
 
-        // the else statement
-        stm->val.ifels.elsec = NULL;
-        next = lexer_peek(lex, 1);
-        if (!next) return NULL;
-        if (cmp_token(next, TOKEN_KEYWORD, "else")) {
-          lexer_consume(lex); // consume 'else'
-          ASTStm *elsec = parse_statement(lex, arena);
-          if (!elsec) return NULL;
-          stm->val.ifels.elsec = elsec;
-        }
+          // expect condition opening '('
+          next = lexer_consume(lex);
+          if (!next) return NULL;
+          if (expect_token(lex, next, TOKEN_BRACKET, PUNC_LPAREN))
+            goto fail;
 
-        return stm;
-      }
+          ASTExpr *cond = parse_expr(lex, arena);
+          if (!cond) goto fail;
+          stm->val.whil.cond = cond;
 
-      case KWD_ELSE: {
-        print_token(next, "syntax error: the 'else' statement must be preceded by an 'if' statement\n");
-        return NULL;
-      }
+          // expect condition closing ')'
+          next = lexer_consume(lex);
+          if (!next) return NULL;
+          if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RPAREN))
+            goto fail;
 
-      case KWD_WHILE: {
-        stm->type = AST_STM_WHILE;
-        stm->tok = next;
+          // code to execute
+          stm->val.whil.code = NULL;
+          hole = &stm->val.whil.code;
+          continue;
+        }
 
-        // expect condition opening '('
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        if (expect_token(next, TOKEN_BRACKET, "("))
-          return NULL;
+        case KWD_RETURN: {
+          stm->type = AST_STM_RETURN;
+          stm->loc = tokloc(lex, next);
+          stm->val.retval = NULL;
 
-        ASTExpr *cond = parse_expr(lex, arena);
-        if (!cond) return NULL;
-        stm->val.whil.cond = cond;
+          // check whether there's return value
+          next = lexer_peek(lex, 1);
+          if (!next) return NULL;
+          if (!cmp_token(next, TOKEN_DELIMETER, PUNC_SEMI)) {
+            ASTExpr *retval = parse_expr(lex, arena);
+            if (!retval) goto fail;
+            stm->val.retval = retval;
+          }
 
-        // expect condition closing ')'
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        if (expect_token(next, TOKEN_BRACKET, ")"))
-          return NULL;
+          // expect delimeter
+          next = lexer_consume(lex);
+          if (!next) return NULL;
+          if (expect_token(lex, next, TOKEN_DELIMETER, PUNC_SEMI))
+            goto fail;
 
-        // code to execute
-        ASTStm *code = parse_statement(lex, arena);
-        if (!code) return NULL;
-        stm->val.whil.code = code;
+          break;
+        }
 
-        return stm;
+        default:
+          // unexpected keyword
+          expect_token(lex, next, -1, 0);
+          goto fail;
       }
+    }
 
-      case KWD_RETURN: {
-        stm->type = AST_STM_RETURN;
-        stm->tok = next;
-        stm->val.retval = NULL;
+    // blocks
+    else if (cmp_token(next, TOKEN_BRACKET, PUNC_LBRACE)) {
+      lexer_consume(lex); // consume '{'
+      stm->type = AST_STM_BLOCK;
+      ASTBlock *block = aaloc(arena, ASTBlock);
+      if (!block) return NULL;
+      block->head = NULL;
+      block->tail = NULL;
+      stm->val.blck = block;
+
+      // process until closing bracket '}'
+      next = lexer_peek(lex, 1);
+      if (!next) return NULL;
+      if (!cmp_token(next, TOKEN_BRACKET, PUNC_RBRACE) && next->type != TOKEN_EOF) {
+        if (parse_push(lex, arena, &stk, stm))
+          goto fail;
+        hole = &block->head;
+        continue;
+      }
 
-        // check whether there's return value
-        next = lexer_peek(lex, 1);
-        if (!next) return NULL;
-        if (!cmp_token(next, TOKEN_DELIMETER, ";")) {
-          ASTExpr *retval = parse_expr(lex, arena);
-          if (!retval) return NULL;
-          stm->val.retval = retval;
-        }
+      // expect block closing '}'
+      next = lexer_consume(lex);
+      if (!next) return NULL;
+      if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RBRACE))
+        goto fail;
+    }
 
-        // expect delimeter
-        next = lexer_consume(lex);
-        if (!next) return NULL;
-        if (expect_token(next, TOKEN_DELIMETER, ";"))
-          return NULL;
+    // expressions
+    else {
+      stm->type = AST_STM_EXPR;
+      ASTExpr *expr = parse_expr(lex, arena);
+      if (!expr) goto fail;
+      stm->val.expr = expr;
 
-        return stm;
+      // semi-colon
+      next = lexer_consume(lex);
+      if (!next) return NULL;
+      if (expect_token(lex, next, TOKEN_DELIMETER, PUNC_SEMI))
+        goto fail;
+    }
+
+    // the statement is complete, so are the open ones it completes
+  done:
+    for (;;) {
+      if (!stk.top) return root;
+      ASTStm *up = stk.top->stm;
+      next = lexer_peek(lex, 1);
+      if (!next) return NULL;
+
+      // the else statement takes the place of the 'if' on the stack
+      if (up->type == AST_STM_IFELSE) {
+        parse_pop(lex, &stk);
+        if (!cmp_token(next, TOKEN_KEYWORD, KWD_ELSE))
+          continue;
+        lexer_consume(lex); // consume 'else'
+        hole = &up->val.ifels.elsec;
+        break;
       }
 
-      default:
-        // unexpected keyword
-        expect_token(next, -1, NULL);
-        return NULL;
+      // the statement goes after the others in the block
+      ASTBlock *block = up->val.blck;
+      block->tail = block->tail ? block->tail->next : block->head;
+      if (!cmp_token(next, TOKEN_BRACKET, PUNC_RBRACE) && next->type != TOKEN_EOF) {
+        hole = &block->tail->next;
+        break;
+      }
+
+      // expect block closing '}'
+      next = lexer_consume(lex);
+      if (!next) return NULL;
+      if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RBRACE))
+        goto fail;
+      parse_pop(lex, &stk);
     }
-  }
+    continue;
 
-  // blocks
-  if (cmp_token(next, TOKEN_BRACKET, "{")) {
-    stm->type = AST_STM_BLOCK;
-    ASTBlock *block = parse_block(lex, arena);
-    if (!block) return NULL;
-    stm->val.blck = block;
-    return stm;
+  fail:
+    // the broken statement stays as an error node, the ones around it go
+    // on if a '}' or the next statement can be found
+    if (!stk.top || parse_recover(lex, start))
+      return NULL;
+    stm->type = AST_STM_ERROR;
+    lex->depth = depth;
+    lex->rdepth = rdepth;
+    for (ParseFrame *frame = stk.top; frame; frame = frame->next)
+      lex->depth++;
+    goto done;
   }
+}
 
-  // expressions
-  stm->type = AST_STM_EXPR;
-  ASTExpr *expr = parse_expr(lex, arena);
-  if (!expr) return NULL;
-  stm->val.expr = expr;
-
-  // semi-colon
-  next = lexer_consume(lex);
-  if (!next) return NULL;
-  if (expect_token(next, TOKEN_DELIMETER, ";"))
-    return NULL;
-
+ASTStm *parse_statement(Lexer *lex, Arena *arena) {
+  uvar depth = lex->depth;
+  uvar rdepth = lex->rdepth;
+  ASTStm *stm = parse_stmloop(lex, arena);
+  lex->depth = depth;
+  lex->rdepth = rdepth;
   return stm;
 }
 
 ASTBlock *parse_block(Lexer *lex, Arena *arena) {
-  Token *next = NULL;
-
   // expect block opening '{'
-  next = lexer_consume(lex);
+  Token *next = lexer_peek(lex, 1);
   if (!next) return NULL;
-  if (expect_token(next, TOKEN_BRACKET, "{"))
+  if (!cmp_token(next, TOKEN_BRACKET, PUNC_LBRACE)) {
+    lexer_consume(lex);
+    expect_token(lex, next, TOKEN_BRACKET, PUNC_LBRACE);
     return NULL;
-
-  // initialize node
-  ASTBlock *node = aaloc(arena, ASTBlock);
-  if (!node) return NULL;
-  ASTStm *head = NULL;
-  ASTStm *tail = NULL;
-
-  // process until closing bracket '}'
-  next = lexer_peek(lex, 1);
-  if (!next) return NULL;
-  while (!cmp_token(next, TOKEN_BRACKET, "}") && !lex->eof) {
-    ASTStm *stm = parse_statement(lex, arena);
-    if (!stm) return NULL;
-
-    // update head and tail pointers
-    if (!head) head = stm;
-    if (tail) tail->next = stm;
-    tail = stm;
-
-    next = lexer_peek(lex, 1);
-    if (!next) return NULL;
   }
 
-  // set pointers
-  node->head = head;
-  node->tail = tail;
-
-  // expect block closing '}'
-  next = lexer_consume(lex);
-  if (!next) return NULL;
-  if (expect_token(next, TOKEN_BRACKET, "}"))
-    return NULL;
-
-  return node;
+  // the statement parser owns the stack of nested blocks
+  ASTStm *stm = parse_statement(lex, arena);
+  if (!stm) return NULL;
+  return stm->val.blck;
 }
 
 ASTFuncDef *parse_funcdef(Lexer *lex, Arena *arena) {
@@ -674,7 +984,7 @@ ASTFuncDef *parse_funcdef(Lexer *lex, Arena *arena) {
   if (!next) return NULL;
 
   // expect declaration keyword
-  if (expect_token(next, TOKEN_KEYWORD, "function"))
+  if (expect_token(lex, next, TOKEN_KEYWORD, KWD_FUNCTION))
     return NULL;
   next = lexer_peek(lex, 1);
   if (!next) return NULL;
@@ -690,11 +1000,11 @@ ASTFuncDef *parse_funcdef(Lexer *lex, Arena *arena) {
   // get function id
   next = lexer_consume(lex);
   if (!next) return NULL;
-  if (expect_token(next, TOKEN_IDENTIFIER, NULL))
+  if (expect_token(lex, next, TOKEN_IDENTIFIER, 0))
     return NULL;
-  fn->tok = next;
-  fn->name = next->lexeme;
-  fn->nlen = next->len;
+  fn->loc = tokloc(lex, next);
+  fn->name = toktext(lex, next);
+  fn->nlen = lexer_toklen(lex, next);
 
   // function args
   bool err = false;
@@ -709,7 +1019,7 @@ ASTFuncDef *parse_funcdef(Lexer *lex, Arena *arena) {
   if (!next) return NULL;
 
   // function definition
-  if (cmp_token(next, TOKEN_BRACKET, "{")) {
+  if (cmp_token(next, TOKEN_BRACKET, PUNC_LBRACE)) {
     ASTBlock *code = parse_block(lex, arena);
     if (!code) return NULL;
     fn->code = code;
@@ -718,7 +1028,7 @@ ASTFuncDef *parse_funcdef(Lexer *lex, Arena *arena) {
 
   // just a declaration
   lexer_consume(lex);
-  if (expect_token(next, TOKEN_DELIMETER, ";"))
+  if (expect_token(lex, next, TOKEN_DELIMETER, PUNC_SEMI))
     return NULL;
   return fn;
 }
@@ -728,7 +1038,7 @@ ASTFuncArgDef *parse_funcarg(Lexer *lex, Arena *arena, bool *err) {
 
   // expect arg opening
   Token *next = lexer_consume(lex);
-  if (!next || expect_token(next, TOKEN_BRACKET, "(")) {
+  if (!next || expect_token(lex, next, TOKEN_BRACKET, PUNC_LPAREN)) {
     *err = true;
     return NULL;
   }
@@ -741,7 +1051,7 @@ ASTFuncArgDef *parse_funcarg(Lexer *lex, Arena *arena, bool *err) {
     *err = true;
     return NULL;
   }
-  while (!cmp_token(next, TOKEN_BRACKET, ")")) {
+  while (!cmp_token(next, TOKEN_BRACKET, PUNC_RPAREN)) {
     ASTFuncArgDef *arg = aaloc(arena, ASTFuncArgDef);
     if (!arg) {
       *err = true;
@@ -765,13 +1075,13 @@ ASTFuncArgDef *parse_funcarg(Lexer *lex, Arena *arena, bool *err) {
 
     // get arg id
     next = lexer_consume(lex);
-    if (!next || expect_token(next, TOKEN_IDENTIFIER, NULL)) {
+    if (!next || expect_token(lex, next, TOKEN_IDENTIFIER, 0)) {
       *err = true;
       return NULL;
     }
-    arg->tok = next;
-    arg->name = next->lexeme;
-    arg->nlen = next->len;
+    arg->loc = tokloc(lex, next);
+    arg->name = toktext(lex, next);
+    arg->nlen = lexer_toklen(lex, next);
 
     // next token
     next = lexer_peek(lex, 1);
@@ -781,14 +1091,14 @@ ASTFuncArgDef *parse_funcarg(Lexer *lex, Arena *arena, bool *err) {
     }
 
     // rest args indicator
-    if (cmp_token(next, TOKEN_OPERATOR, "...")) {
+    if (cmp_token(next, TOKEN_OPERATOR, OP_TRP_DOT)) {
       lexer_consume(lex); // ...
       arg->restarr = true;
       break;
     }
 
     // default value
-    if (cmp_token(next, TOKEN_OPERATOR, "=")) {
+    if (cmp_token(next, TOKEN_OPERATOR, OP_EQL)) {
       lexer_consume(lex);
       // parse expression with precedence 2 (exclude comma operator)
       ASTExpr *defval = parse_infix(lex, arena, parse_factor(lex, arena), 2);
@@ -807,29 +1117,29 @@ ASTFuncArgDef *parse_funcarg(Lexer *lex, Arena *arena, bool *err) {
 
     // required arg after optional ones
     else if (defargs && (
-      cmp_token(next, TOKEN_OPERATOR, ",") ||
-      cmp_token(next, TOKEN_BRACKET, ")")
+      cmp_token(next, TOKEN_OPERATOR, OP_CMM) ||
+      cmp_token(next, TOKEN_BRACKET, PUNC_RPAREN)
     )) {
-      print_token(lexer_peek(lex, 0),
+      print_token(lex, lexer_peek(lex, 0),
         "syntax error: unexpected required argument after optional parameters\n");
       *err = true;
       return NULL;
     }
 
     // next arg
-    if (cmp_token(next, TOKEN_OPERATOR, ",")) {
+    if (cmp_token(next, TOKEN_OPERATOR, OP_CMM)) {
       lexer_consume(lex);
       continue;
     }
 
     // end arg defs
-    if (cmp_token(next, TOKEN_BRACKET, ")"))
+    if (cmp_token(next, TOKEN_BRACKET, PUNC_RPAREN))
       break;
   }
 
   // expect closing ')'
   next = lexer_consume(lex);
-  if (!next || expect_token(next, TOKEN_BRACKET, ")")) {
+  if (!next || expect_token(lex, next, TOKEN_BRACKET, PUNC_RPAREN)) {
     *err = true;
     return NULL;
   }
@@ -847,24 +1157,24 @@ ASTEnum *parse_enum(Lexer *lex, Arena *arena) {
   if (!next) return NULL;
 
   // expect 'enum'
-  if (expect_token(next, TOKEN_KEYWORD, "enum"))
+  if (expect_token(lex, next, TOKEN_KEYWORD, KWD_ENUM))
     return NULL;
 
   // get enum id
   next = lexer_consume(lex);
   if (!next) return NULL;
-  if (expect_token(next, TOKEN_IDENTIFIER, NULL))
+  if (expect_token(lex, next, TOKEN_IDENTIFIER, 0))
     return NULL;
-  enode->tok = next;
-  enode->name = next->lexeme;
-  enode->nlen = next->len;
+  enode->loc = tokloc(lex, next);
+  enode->name = toktext(lex, next);
+  enode->nlen = lexer_toklen(lex, next);
 
   // type or definition
   next = lexer_peek(lex, 1);
   if (!next) return NULL;
 
   // type found
-  if (!cmp_token(next, TOKEN_BRACKET, "{")) {
+  if (!cmp_token(next, TOKEN_BRACKET, PUNC_LBRACE)) {
     ASTTypeRef *type = parse_typeref(lex, arena);
     if (!type) return NULL;
     enode->type = type;
@@ -873,14 +1183,14 @@ ASTEnum *parse_enum(Lexer *lex, Arena *arena) {
   }
 
   // definition of the enum
-  if (expect_token(next, TOKEN_BRACKET, "{"))
+  if (expect_token(lex, next, TOKEN_BRACKET, PUNC_LBRACE))
     return NULL;
   lexer_consume(lex); // consume '{'
   next = lexer_peek(lex, 1);
   if (!next) return NULL;
 
   ASTEnumEntry *curr = NULL;
-  while (!cmp_token(next, TOKEN_BRACKET, "}")) {
+  while (!cmp_token(next, TOKEN_BRACKET, PUNC_RBRACE)) {
     ASTEnumEntry *ent = aaloc(arena, ASTEnumEntry);
     if (!ent) return NULL;
     ent->next = NULL;
@@ -893,27 +1203,29 @@ ASTEnum *parse_enum(Lexer *lex, Arena *arena) {
     // get enum name
     next = lexer_consume(lex);
     if (!next) return NULL;
-    if (expect_token(next, TOKEN_IDENTIFIER, NULL))
+    if (expect_token(lex, next, TOKEN_IDENTIFIER, 0))
       return NULL;
-    ent->tok = next;
-    ent->name = next->lexeme;
-    ent->nlen = next->len;
+    ent->loc = tokloc(lex, next);
+    ent->name = toktext(lex, next);
+    ent->nlen = lexer_toklen(lex, next);
 
     // process constant value
     next = lexer_peek(lex, 1);
     if (!next) return NULL;
-    if (cmp_token(next, TOKEN_OPERATOR, "=")) {
+    if (cmp_token(next, TOKEN_OPERATOR, OP_EQL)) {
       lexer_consume(lex); // consume '='
       // parse expression, min prec 2 to exclude comma
       ASTExpr *cnst = parse_infix(lex, arena, parse_factor(lex, arena), 2);
       if (!cnst) return NULL;
+      if (enode->type)
+        check_intlit(lex, enode->type, cnst);
       ent->cnst = cnst;
       next = lexer_peek(lex, 1);
       if (!next) return NULL;
     }
 
     // if there's no comma, it is the last element
-    if (!cmp_token(next, TOKEN_OPERATOR, ","))
+    if (!cmp_token(next, TOKEN_OPERATOR, OP_CMM))
       break;
 
     lexer_consume(lex); // consume ','
@@ -924,14 +1236,14 @@ ASTEnum *parse_enum(Lexer *lex, Arena *arena) {
 
   // no enum entry was processed
   if (!curr) {
-    print_token(next, "syntax error: empty enum definition not allowed\n");
+    print_token(lex, next, "syntax error: empty enum definition not allowed\n");
     return NULL;
   }
 
   // expect closing '}'
   next = lexer_consume(lex);
   if (!next) return NULL;
-  if (expect_token(next, TOKEN_BRACKET, "}"))
+  if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RBRACE))
     return NULL;
 
   return enode;
@@ -942,19 +1254,20 @@ ASTTypeRef *parse_typeref(Lexer *lex, Arena *arena) {
   if (!node) return NULL;
   Token *next = lexer_consume(lex);
   if (!next) return NULL;
-  node->tok = next;
+  node->loc = tokloc(lex, next);
 
   // a primitive type
-  if (next->type == TOKEN_KEYWORD && iskwdprim(getkwd(next->lexeme))) {
+  if (next->type == TOKEN_KEYWORD && iskwdprim(next->sub)) {
     node->type = AST_TYPE_PRIMITIVE;
-    node->val.type = getkwd(next->lexeme);
+    node->val.type = next->sub;
   }
 
   // a function type
   // function(ret)(type arg, type arg2, type arg3 = default)
-  else if (cmp_token(next, TOKEN_KEYWORD, "function")) {
+  else if (cmp_token(next, TOKEN_KEYWORD, KWD_FUNCTION)) {
+    if (parse_recurse(lex, node->loc)) return NULL;
     next = lexer_consume(lex);
-    if (!next || expect_token(next, TOKEN_BRACKET, "("))
+    if (!next || expect_token(lex, next, TOKEN_BRACKET, PUNC_LPAREN))
       return NULL;
 
     // get return type
@@ -963,7 +1276,7 @@ ASTTypeRef *parse_typeref(Lexer *lex, Arena *arena) {
 
     // expect closing ')' for return type
     next = lexer_consume(lex);
-    if (!next || expect_token(next, TOKEN_BRACKET, ")"))
+    if (!next || expect_token(lex, next, TOKEN_BRACKET, PUNC_RPAREN))
       return NULL;
 
     bool err = false;
@@ -971,39 +1284,41 @@ ASTTypeRef *parse_typeref(Lexer *lex, Arena *arena) {
     if (err) return NULL;
 
     // set type info
+    node->type = AST_TYPE_FUNCTION;
     node->val.func.ret  = rettype;
     node->val.func.args = args;
+    parse_return(lex);
   }
 
   // type name reference
-  else if (cmp_token(next, TOKEN_IDENTIFIER, NULL)) {
+  else if (cmp_token(next, TOKEN_IDENTIFIER, 0)) {
     node->type = AST_TYPE_NAME;
-    node->val.tname.name = next->lexeme;
-    node->val.tname.nlen = next->len;
+    node->val.tname.name = toktext(lex, next);
+    node->val.tname.nlen = lexer_toklen(lex, next);
   }
 
   // unknown type token
   else {
-    expect_token(next, -1, NULL);
+    expect_token(lex, next, -1, 0);
     return NULL;
   }
 
   // process array types
   next = lexer_peek(lex, 1);
   if (!next) return NULL;
-  while (cmp_token(next, TOKEN_BRACKET, "[")) {
-    Token *tok = next; // tok used to ast
+  while (cmp_token(next, TOKEN_BRACKET, PUNC_LSQUARE)) {
+    SrcLoc loc = tokloc(lex, next); // loc used to ast
     lexer_consume(lex); // consume '['
 
     // expect ']'
     next = lexer_consume(lex);
     if (!next) return NULL;
-    if (expect_token(next, TOKEN_BRACKET, "]"))
+    if (expect_token(lex, next, TOKEN_BRACKET, PUNC_RSQUARE))
       return NULL;
 
     ASTTypeRef *ref = aaloc(arena, ASTTypeRef);
     if (!ref) return NULL;
-    ref->tok = tok;
+    ref->loc = loc;
     ref->type = AST_TYPE_ARRAY;
     ref->val.aelem = node;
     node = ref;
@@ -1022,7 +1337,7 @@ ASTTypeAlias *parse_typealias(Lexer *lex, Arena *arena) {
 
   // expect 'type'
   next = lexer_consume(lex);
-  if (!next || expect_token(next, TOKEN_KEYWORD, "type"))
+  if (!next || expect_token(lex, next, TOKEN_KEYWORD, KWD_TYPE))
     return NULL;
 
   // TODO: integrate generics
@@ -1030,15 +1345,15 @@ ASTTypeAlias *parse_typealias(Lexer *lex, Arena *arena) {
 
   // get type alias name
   next = lexer_consume(lex);
-  if (!next || expect_token(next, TOKEN_IDENTIFIER, NULL))
+  if (!next || expect_token(lex, next, TOKEN_IDENTIFIER, 0))
     return NULL;
-  node->tok = next;
-  node->name = next->lexeme;
-  node->nlen = next->len;
+  node->loc = tokloc(lex, next);
+  node->name = toktext(lex, next);
+  node->nlen = lexer_toklen(lex, next);
 
   // expect '='
   next = lexer_consume(lex);
-  if (!next || expect_token(next, TOKEN_OPERATOR, "="))
+  if (!next || expect_token(lex, next, TOKEN_OPERATOR, OP_EQL))
     return NULL;
 
   // get definition
@@ -1048,7 +1363,7 @@ ASTTypeAlias *parse_typealias(Lexer *lex, Arena *arena) {
 
   // expect ';'
   next = lexer_consume(lex);
-  if (!next || expect_token(next, TOKEN_DELIMETER, ";"))
+  if (!next || expect_token(lex, next, TOKEN_DELIMETER, PUNC_SEMI))
     return NULL;
 
   return node;
@@ -1067,35 +1382,58 @@ ASTRoot *parse_root(Lexer *lex, Arena *arena) {
   while (tok->type != TOKEN_EOF) {
     ASTDecl *def = aaloc(arena, ASTDecl);
     if (!def) return NULL;
+    def->next = NULL;
+    uvar start = lex->pind;
+    uvar nerrs = lex->nerrs;
+    SrcLoc loc = tokloc(lex, tok);
+    bool ok = false;
 
     // a function
-    if (cmp_token(tok, TOKEN_KEYWORD, "function")) {
+    if (cmp_token(tok, TOKEN_KEYWORD, KWD_FUNCTION)) {
       ASTFuncDef *fn = parse_funcdef(lex, arena);
-      if (!fn) return NULL;
       def->type = AST_ROOT_FUNCDEF;
       def->val.func = fn;
+      ok = fn != NULL;
     }
 
     // an enum
-    else if (cmp_token(tok, TOKEN_KEYWORD, "enum")) {
+    else if (cmp_token(tok, TOKEN_KEYWORD, KWD_ENUM)) {
       ASTEnum *enumr = parse_enum(lex, arena);
-      if (!enumr) return NULL;
       def->type = AST_ROOT_ENUM;
       def->val.enumr = enumr;
+      ok = enumr != NULL;
     }
 
     // a type alias
-    else if (cmp_token(tok, TOKEN_KEYWORD, "type")) {
+    else if (cmp_token(tok, TOKEN_KEYWORD, KWD_TYPE)) {
       ASTTypeAlias *talias = parse_typealias(lex, arena);
-      if (!talias) return NULL;
       def->type = AST_ROOT_TALIAS;
       def->val.talias = talias;
+      ok = talias != NULL;
     }
 
     // unknown token
-    else {
-      expect_token(tok, -1, NULL);
-      return NULL;
+    else
+      expect_token(lex, tok, -1, 0);
+
+    // skip to the next declaration, errors in statements are counted
+    // where they were found
+    if (!ok) {
+      if (lex->mute) return NULL;
+      def->type = AST_ROOT_ERROR;
+      def->val.err = loc;
+      lex->depth = 0;
+      lex->rdepth = 0;
+      if (lex->nerrs == nerrs)
+        parse_error(lex);
+      if (lex->pind == start)
+        lexer_consume(lex);
+      tok = parse_sync(lex, start);
+      while (cmp_token(tok, TOKEN_BRACKET, PUNC_RBRACE)) {
+        lexer_consume(lex);
+        tok = parse_sync(lex, lex->pind);
+      }
+      if (!tok) return NULL;
     }
 
     if (curr) curr->next = def;
@@ -1105,6 +1443,8 @@ ASTRoot *parse_root(Lexer *lex, Arena *arena) {
     // get next token
     tok = lexer_peek(lex, 1);
     if (!tok) return NULL;
+    if (tok->type == TOKEN_ERROR || parse_stopped(lex))
+      break;
   }
 
   root->tail = curr;
@@ -1114,10 +1454,34 @@ ASTRoot *parse_root(Lexer *lex, Arena *arena) {
 
 ASTRoot *parse(Lexer *lex, Arena *arena) {
   if (!lex || !arena) return NULL;
-  return parse_root(lex, arena);
+  ASTRoot *root = parse_root(lex, arena);
+  return lex->nerrs ? NULL : root;
 }
 
 #ifdef _DEBUG
+static void print_type(ASTTypeRef *type) {
+  if (!type) {
+    printf("[null]");
+    return;
+  }
+
+  switch (type->type) {
+    case AST_TYPE_PRIMITIVE:
+      printf("%s", KeywordNames[type->val.type]);
+      break;
+    case AST_TYPE_ARRAY:
+      print_type(type->val.aelem);
+      printf("[]");
+      break;
+    case AST_TYPE_FUNCTION:
+      printf("function");
+      break;
+    case AST_TYPE_NAME:
+      pview(type->val.tname.name, type->val.tname.nlen);
+      break;
+  }
+}
+
 void print_expr(ASTExpr *expr) {
   if (!expr) {
     printf("[null]");
@@ -1161,6 +1525,43 @@ void print_expr(ASTExpr *expr) {
     case AST_EXPR_IDENTIFIER:
       pview(expr->val.ident.name, expr->val.ident.len);
       break;
+    case AST_EXPR_STRING:
+      pview(expr->val.str.raw, expr->val.str.len);
+      break;
+    case AST_EXPR_ARRAY:
+      fputc('[', stdout);
+      for (ASTArray *arr = expr->val.arr; arr; arr = arr->next) {
+        print_expr(arr->expr);
+        if (arr->next) printf(", ");
+      }
+      fputc(']', stdout);
+      break;
+    case AST_EXPR_INTEGER:
+      pview(expr->val.intg.text, expr->val.intg.len);
+      break;
+    case AST_EXPR_FLOAT:
+      pview(expr->val.flt.text, expr->val.flt.len);
+      printf("=%g", expr->val.flt.val);
+      break;
+    case AST_EXPR_CALL:
+      print_expr(expr->val.fcall.fname);
+      fputc('(', stdout);
+      for (ASTFuncArg *arg = expr->val.fcall.args; arg; arg = arg->next) {
+        if (arg->target) {
+          pview(arg->target, arg->tlen);
+          fputc('=', stdout);
+        }
+        print_expr(arg->val);
+        if (arg->next) printf(", ");
+      }
+      fputc(')', stdout);
+      break;
+    case AST_EXPR_CAST:
+      fputc('<', stdout);
+      print_type(expr->val.cast.type);
+      fputc('>', stdout);
+      print_expr(expr->val.cast.val);
+      break;
   }
 }
 #endif // _DEBUG
@@ -13,8 +13,10 @@ typedef struct ASTIdentifier {
 } ASTIdentifier;
 
 typedef struct ASTString {
-  char *raw;
+  char *raw;            /* view to the literal, quotes included */
   uvar len;
+  char *val;            /* decoded bytes, a view to raw if no escapes */
+  uvar vlen;            /* length of val */
 } ASTString;
 
 typedef struct ASTArray {
@@ -25,8 +27,17 @@ typedef struct ASTArray {
 typedef struct ASTInteger {
   char *text;
   uvar len;
+  uint64_t val;         /* value, decoded at parse time */
+  uint32_t *big;        /* little-endian limbs if val overflowed, or NULL */
+  uvar nbig;            /* number of limbs in big */
 } ASTInteger;
 
+typedef struct ASTFloat {
+  char *text;
+  uvar len;
+  double val;           /* value, converted at parse time */
+} ASTFloat;
+
 typedef struct ASTUnaryOp {
   struct ASTExpr *val;
   bool isprefix;
@@ -68,6 +79,7 @@ typedef enum {
   AST_EXPR_STRING,
   AST_EXPR_ARRAY,
   AST_EXPR_INTEGER,
+  AST_EXPR_FLOAT,
   AST_EXPR_UNOP,
   AST_EXPR_BINOP,
   AST_EXPR_TERNOP,
@@ -80,6 +92,7 @@ typedef union {
   ASTString str;
   ASTArray *arr;
   ASTInteger intg;
+  ASTFloat flt;
   ASTUnaryOp unop;
   ASTBinaryOp binop;
   ASTTernaryOp ternop;
@@ -88,7 +101,7 @@ typedef union {
 } ASTExprVal;
 
 typedef struct ASTExpr {
-  Token *tok;
+  SrcLoc loc;
   ASTExprType type;
   ASTExprVal  val;
 } ASTExpr;
@@ -118,6 +131,7 @@ typedef enum {
   AST_STM_WHILE,
   AST_STM_RETURN,
   AST_STM_BLOCK,
+  AST_STM_ERROR,        // a statement that failed to parse
 } ASTStmType;
 
 typedef union {
@@ -130,7 +144,7 @@ typedef union {
 } ASTStmVal;
 
 typedef struct ASTStm {
-  Token *tok;
+  SrcLoc loc;
   struct ASTStm *next; // used on ast blocks
   ASTStmType type;
   ASTStmVal  val;
@@ -142,7 +156,7 @@ typedef struct ASTBlock {
 } ASTBlock;
 
 typedef struct ASTFuncArgDef {
-  Token *tok;
+  SrcLoc loc;
   struct ASTFuncArgDef *next;
   struct ASTTypeRef *type;
   char *name;
@@ -152,7 +166,7 @@ typedef struct ASTFuncArgDef {
 } ASTFuncArgDef;
 
 typedef struct ASTFuncDef {
-  Token *tok;
+  SrcLoc loc;
   char *name;
   uvar nlen;
   ASTFuncArgDef *args;
@@ -161,7 +175,7 @@ typedef struct ASTFuncDef {
 } ASTFuncDef;
 
 typedef struct ASTEnumEntry {
-  Token *tok;
+  SrcLoc loc;
   struct ASTEnumEntry *next;
   char *name;
   uvar nlen;
@@ -169,7 +183,7 @@ typedef struct ASTEnumEntry {
 } ASTEnumEntry;
 
 typedef struct ASTEnum {
-  Token *tok;
+  SrcLoc loc;
   char *name;
   uvar nlen;
   ASTEnumEntry *head;
@@ -178,7 +192,7 @@ typedef struct ASTEnum {
 } ASTEnum;
 
 typedef struct ASTTypeAlias {
-  Token *tok;
+  SrcLoc loc;
   char *name;
   uvar nlen;
   struct ASTTypeRef *type;
@@ -209,7 +223,7 @@ typedef union {
 } ASTTypeVal;
 
 typedef struct ASTTypeRef {
-  Token *tok;
+  SrcLoc loc;
   ASTTypeType type;
   ASTTypeVal  val;
 } ASTTypeRef;
@@ -218,12 +232,14 @@ typedef enum {
   AST_ROOT_FUNCDEF,
   AST_ROOT_ENUM,
   AST_ROOT_TALIAS,
+  AST_ROOT_ERROR,       // a declaration that failed to parse
 } ASTDeclType;
 
 typedef union {
   ASTFuncDef *func;
   ASTEnum *enumr;
   ASTTypeAlias *talias;
+  SrcLoc err;           // where the failed declaration starts
 } ASTDeclVal;
 
 typedef struct ASTDecl {
@@ -238,6 +254,24 @@ typedef struct ASTRoot {
   ASTDecl *tail;
 } ASTRoot;
 
+// the state to go back to when a speculative parse fails
+typedef struct {
+  uvar pind;            /* lexer position indicator */
+  uvar depth;           /* nesting depth */
+  uvar rdepth;          /* recursion depth */
+  ArenaMark mark;       /* arena cursor */
+} ParseCheckpoint;
+
+/* start a speculative parse, diagnostics are dropped until it ends */
+ParseCheckpoint parse_checkpoint(Lexer *lex, Arena *arena);
+
+/* end a speculative parse that failed, the tokens taken and the nodes
+   allocated since the checkpoint are given back */
+void parse_rollback(Lexer *lex, Arena *arena, ParseCheckpoint *cp);
+
+/* end a speculative parse that succeeded, keeping its nodes */
+void parse_commit(Lexer *lex, ParseCheckpoint *cp);
+
 /* process identifiers */
 ASTExpr *parse_identifier(Lexer *lex, Arena *arena);
 
@@ -277,10 +311,14 @@ ASTTypeRef *parse_typeref(Lexer *lex, Arena *arena);
 /* process type aliases */
 ASTTypeAlias *parse_typealias(Lexer *lex, Arena *arena);
 
-/* process root node */
+/* process root node. after a syntax error it skips to the next
+   statement or declaration and goes on, leaving an error node in place
+   of the broken one, until lex->maxerrs errors. the tree is returned even
+   if there were errors (see lex->nerrs), NULL if it could not be made */
 ASTRoot *parse_root(Lexer *lex, Arena *arena);
 
-/* parse ast tree given the source lexer and an arena allocator */
+/* parse ast tree given the source lexer and an arena allocator, returns
+   NULL if there were errors */
 ASTRoot *parse(Lexer *lex, Arena *arena);
 
 #ifdef _DEBUG
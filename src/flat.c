@@ -0,0 +1,682 @@
+#include "flat.h"
+#include "types.h"
+#include "ast.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// header of a written blob, the arrays follow it in the order of
+// flat_layout(). numbers are in host byte order
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t cnt;
+  uint32_t ecnt;
+  uint32_t ncnt;
+  uint32_t scnt;
+  uint32_t bcnt;
+  uint32_t root;
+} FlatHeader;
+
+#define FLAT_MAGIC   "ZNCF"
+#define FLAT_VERSION 2
+
+// flattening state, an allocation failure makes everything after it a
+// no-op and is checked once at the end
+typedef struct {
+  FlatAST *ast;
+  bool oom;
+  struct FlatFrame *top;    // innermost node being flattened
+  struct FlatFrame *spare;  // popped frames, for reuse
+} Flattener;
+
+// grow an array to hold need elements
+static bool flat_grow(Flattener *fl, void **arr, uint32_t *alloc, uint32_t need, size_t elem) {
+  if (fl->oom)
+    return false;
+  if (need <= *alloc)
+    return true;
+  uint32_t size = *alloc ? *alloc : 64;
+  while (size < need) size *= 2;
+  void *tmp = realloc(*arr, elem * size);
+  if (!tmp) {
+    fl->oom = true;
+    return false;
+  }
+  *arr = tmp;
+  *alloc = size;
+  return true;
+}
+
+// append a node, returns its index
+static uint32_t flat_node(Flattener *fl, FlatKind kind, int sub, SrcLoc loc,
+                          uint32_t lhs, uint32_t rhs) {
+  FlatAST *ast = fl->ast;
+  uint32_t old = ast->alloc;
+  if (ast->cnt == ast->alloc) {
+    // the arrays of the nodes grow together
+    uint32_t alloc = old;
+    if (!flat_grow(fl, (void**)&ast->kind, &alloc, old + 1, sizeof(uint8_t)))
+      return 0;
+    alloc = old;
+    if (!flat_grow(fl, (void**)&ast->sub, &alloc, old + 1, sizeof(uint8_t)))
+      return 0;
+    alloc = old;
+    if (!flat_grow(fl, (void**)&ast->loc, &alloc, old + 1, sizeof(SrcLoc)))
+      return 0;
+    alloc = old;
+    if (!flat_grow(fl, (void**)&ast->data, &alloc, old + 1, sizeof(FlatData)))
+      return 0;
+    ast->alloc = alloc;
+  }
+  if (fl->oom)
+    return 0;
+
+  uint32_t idx = ast->cnt++;
+  ast->kind[idx] = kind;
+  ast->sub[idx]  = sub;
+  ast->loc[idx]  = loc;
+  ast->data[idx].lhs = lhs;
+  ast->data[idx].rhs = rhs;
+  return idx;
+}
+
+// reserve n extra slots, returns the first
+static uint32_t flat_extra(Flattener *fl, uint32_t n) {
+  FlatAST *ast = fl->ast;
+  if (!flat_grow(fl, (void**)&ast->extra, &ast->ealloc, ast->ecnt + n, sizeof(uint32_t)))
+    return 0;
+  uint32_t start = ast->ecnt;
+  memset(ast->extra + start, 0, sizeof(uint32_t) * n);
+  ast->ecnt += n;
+  return start;
+}
+
+// set an extra slot, the array may have moved since it was reserved
+static void flat_setextra(Flattener *fl, uint32_t slot, uint32_t val) {
+  if (!fl->oom)
+    fl->ast->extra[slot] = val;
+}
+
+// copy bytes into a new span, aligned to 4 so limbs can be read in place
+static uint32_t flat_span(Flattener *fl, const char *text, uvar len) {
+  FlatAST *ast = fl->ast;
+  uint32_t off = (ast->bcnt + 3) & ~3u;
+  if (!flat_grow(fl, (void**)&ast->bytes, &ast->balloc, off + len + 1, sizeof(char)) ||
+      !flat_grow(fl, (void**)&ast->spans, &ast->salloc, ast->scnt + 1, sizeof(FlatSpan)))
+    return 0;
+  memset(ast->bytes + ast->bcnt, 0, off - ast->bcnt);
+  memcpy(ast->bytes + off, text, len);
+  ast->bytes[off + len] = '\0';
+  ast->bcnt = off + len + 1;
+
+  uint32_t idx = ast->scnt++;
+  ast->spans[idx].off = off;
+  ast->spans[idx].len = len;
+  return idx;
+}
+
+// append a number
+static uint32_t flat_num(Flattener *fl, uint64_t val) {
+  FlatAST *ast = fl->ast;
+  if (!flat_grow(fl, (void**)&ast->nums, &ast->nalloc, ast->ncnt + 1, sizeof(uint64_t)))
+    return 0;
+  ast->nums[ast->ncnt] = val;
+  return ast->ncnt++;
+}
+
+// what a frame flattens
+typedef enum {
+  FLAT_WORK_EXPR,
+  FLAT_WORK_STM,
+  FLAT_WORK_BLOCK,
+  FLAT_WORK_TYPE,
+  FLAT_WORK_PARAMS,
+} FlatWork;
+
+// a node being flattened. a child is done by pushing a frame for it, the
+// parent resumes at its step with the index of the child
+typedef struct FlatFrame {
+  struct FlatFrame *next;
+  FlatWork work;
+  int step;
+  void *node;           // the node, its type depends on the work
+  void *iter;           // the item of a list being done
+  SrcLoc loc;           // location of a block
+  uint32_t lhs;         // operand kept between the steps
+  uint32_t ops;         // extra slots being filled
+  uint32_t i;           // items of a list done
+} FlatFrame;
+
+static void flat_push(Flattener *fl, FlatWork work, void *node) {
+  FlatFrame *frame = fl->spare;
+  if (frame) {
+    fl->spare = frame->next;
+  } else {
+    frame = (FlatFrame*)malloc(sizeof(FlatFrame));
+    if (!frame) {
+      fl->oom = true;
+      return;
+    }
+  }
+  memset(frame, 0, sizeof(FlatFrame));
+  frame->work = work;
+  frame->node = node;
+  frame->next = fl->top;
+  fl->top = frame;
+}
+
+static void flat_pop(Flattener *fl) {
+  FlatFrame *frame = fl->top;
+  fl->top = frame->next;
+  frame->next = fl->spare;
+  fl->spare = frame;
+}
+
+// flatten a child first, the frame resumes at step. returns false so the
+// step functions can return it as not done
+static bool flat_child(Flattener *fl, FlatFrame *f, int step, FlatWork work, void *node) {
+  f->step = step;
+  flat_push(fl, work, node);
+  return false;
+}
+
+// the step functions return true when the frame is done, ret holds the
+// index of the child that was done before and gets the index of the frame
+
+static bool flat_params(Flattener *fl, FlatFrame *f, uint32_t *ret) {
+  ASTFuncArgDef *arg = f->iter;
+  switch (f->step) {
+    case 0: {
+      uint32_t n = 0;
+      for (arg = f->node; arg; arg = arg->next)
+        n++;
+      f->ops = flat_extra(fl, n + 1);
+      flat_setextra(fl, f->ops, n);
+      arg = f->node;
+      break;
+    }
+    case 1:
+      flat_setextra(fl, f->lhs, *ret);
+      return flat_child(fl, f, 2, FLAT_WORK_EXPR, arg->defval);
+    case 2: {
+      flat_setextra(fl, f->lhs + 1, *ret);
+      uint32_t name = flat_span(fl, arg->name, arg->nlen);
+      uint32_t node = flat_node(fl, FLAT_PARAM, arg->restarr, arg->loc, name, f->lhs);
+      flat_setextra(fl, f->ops + 1 + f->i++, node);
+      arg = arg->next;
+      break;
+    }
+  }
+  if (arg) {
+    f->iter = arg;
+    f->lhs = flat_extra(fl, 2);
+    return flat_child(fl, f, 1, FLAT_WORK_TYPE, arg->type);
+  }
+  *ret = f->ops;
+  return true;
+}
+
+static bool flat_type(Flattener *fl, FlatFrame *f, uint32_t *ret) {
+  ASTTypeRef *type = f->node;
+  if (!type) {
+    *ret = 0;
+    return true;
+  }
+  switch (type->type) {
+    case AST_TYPE_PRIMITIVE:
+      *ret = flat_node(fl, FLAT_TPRIM, type->val.type, type->loc, 0, 0);
+      return true;
+    case AST_TYPE_ARRAY:
+      if (f->step == 0)
+        return flat_child(fl, f, 1, FLAT_WORK_TYPE, type->val.aelem);
+      *ret = flat_node(fl, FLAT_TARRAY, 0, type->loc, *ret, 0);
+      return true;
+    case AST_TYPE_FUNCTION:
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_TYPE, type->val.func.ret);
+        case 1:
+          f->lhs = *ret;
+          return flat_child(fl, f, 2, FLAT_WORK_PARAMS, type->val.func.args);
+      }
+      *ret = flat_node(fl, FLAT_TFUNC, 0, type->loc, f->lhs, *ret);
+      return true;
+    case AST_TYPE_NAME: {
+      uint32_t name = flat_span(fl, type->val.tname.name, type->val.tname.nlen);
+      *ret = flat_node(fl, FLAT_TNAME, 0, type->loc, name, 0);
+      return true;
+    }
+  }
+  *ret = 0;
+  return true;
+}
+
+static bool flat_expr(Flattener *fl, FlatFrame *f, uint32_t *ret) {
+  ASTExpr *expr = f->node;
+  if (!expr) {
+    *ret = 0;
+    return true;
+  }
+  switch (expr->type) {
+    case AST_EXPR_IDENTIFIER: {
+      uint32_t name = flat_span(fl, expr->val.ident.name, expr->val.ident.len);
+      *ret = flat_node(fl, FLAT_IDENT, 0, expr->loc, name, 0);
+      return true;
+    }
+    case AST_EXPR_STRING: {
+      uint32_t str = flat_span(fl, expr->val.str.val, expr->val.str.vlen);
+      *ret = flat_node(fl, FLAT_STRING, 0, expr->loc, str, 0);
+      return true;
+    }
+    case AST_EXPR_ARRAY: {
+      ASTArray *arr = f->iter;
+      if (f->step == 0) {
+        uint32_t n = 0;
+        for (arr = expr->val.arr; arr; arr = arr->next)
+          n++;
+        f->ops = flat_extra(fl, n + 1);
+        flat_setextra(fl, f->ops, n);
+        arr = expr->val.arr;
+      } else {
+        flat_setextra(fl, f->ops + 1 + f->i++, *ret);
+        arr = arr->next;
+      }
+      if (arr) {
+        f->iter = arr;
+        return flat_child(fl, f, 1, FLAT_WORK_EXPR, arr->expr);
+      }
+      *ret = flat_node(fl, FLAT_ARRAY, 0, expr->loc, f->ops, 0);
+      return true;
+    }
+    case AST_EXPR_INTEGER: {
+      ASTInteger *intg = &expr->val.intg;
+      if (intg->big) {
+        uint32_t limbs = flat_span(fl, (char*)intg->big, intg->nbig * sizeof(uint32_t));
+        *ret = flat_node(fl, FLAT_BIGINT, 0, expr->loc, limbs, 0);
+        return true;
+      }
+      *ret = flat_node(fl, FLAT_INT, 0, expr->loc, flat_num(fl, intg->val), 0);
+      return true;
+    }
+    case AST_EXPR_FLOAT: {
+      uint64_t bits;
+      memcpy(&bits, &expr->val.flt.val, sizeof(bits));
+      *ret = flat_node(fl, FLAT_FLOAT, 0, expr->loc, flat_num(fl, bits), 0);
+      return true;
+    }
+    case AST_EXPR_UNOP: {
+      ASTUnaryOp *op = &expr->val.unop;
+      if (f->step == 0)
+        return flat_child(fl, f, 1, FLAT_WORK_EXPR, op->val);
+      *ret = flat_node(fl, FLAT_UNOP, op->op, expr->loc, *ret, op->isprefix);
+      return true;
+    }
+    case AST_EXPR_BINOP: {
+      ASTBinaryOp *op = &expr->val.binop;
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_EXPR, op->lhs);
+        case 1:
+          f->lhs = *ret;
+          return flat_child(fl, f, 2, FLAT_WORK_EXPR, op->rhs);
+      }
+      *ret = flat_node(fl, FLAT_BINOP, op->op, expr->loc, f->lhs, *ret);
+      return true;
+    }
+    case AST_EXPR_TERNOP: {
+      ASTTernaryOp *op = &expr->val.ternop;
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_EXPR, op->lch);
+        case 1:
+          f->lhs = *ret;
+          f->ops = flat_extra(fl, 2);
+          return flat_child(fl, f, 2, FLAT_WORK_EXPR, op->mch);
+        case 2:
+          flat_setextra(fl, f->ops, *ret);
+          return flat_child(fl, f, 3, FLAT_WORK_EXPR, op->rch);
+      }
+      flat_setextra(fl, f->ops + 1, *ret);
+      *ret = flat_node(fl, FLAT_TERNOP, op->op, expr->loc, f->lhs, f->ops);
+      return true;
+    }
+    case AST_EXPR_CALL: {
+      ASTFuncCall *call = &expr->val.fcall;
+      ASTFuncArg *arg = f->iter;
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_EXPR, call->fname);
+        case 1: {
+          f->lhs = *ret;
+          uint32_t n = 0;
+          for (arg = call->args; arg; arg = arg->next)
+            n++;
+          f->ops = flat_extra(fl, n + 1);
+          flat_setextra(fl, f->ops, n);
+          arg = call->args;
+          break;
+        }
+        case 2: {
+          uint32_t name = arg->target ? flat_span(fl, arg->target, arg->tlen) : 0;
+          uint32_t node = flat_node(fl, FLAT_ARG, 0, arg->val->loc, *ret, name);
+          flat_setextra(fl, f->ops + 1 + f->i++, node);
+          arg = arg->next;
+          break;
+        }
+      }
+      if (arg) {
+        f->iter = arg;
+        return flat_child(fl, f, 2, FLAT_WORK_EXPR, arg->val);
+      }
+      *ret = flat_node(fl, FLAT_CALL, 0, expr->loc, f->lhs, f->ops);
+      return true;
+    }
+    case AST_EXPR_CAST:
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_TYPE, expr->val.cast.type);
+        case 1:
+          f->lhs = *ret;
+          return flat_child(fl, f, 2, FLAT_WORK_EXPR, expr->val.cast.val);
+      }
+      *ret = flat_node(fl, FLAT_CAST, 0, expr->loc, f->lhs, *ret);
+      return true;
+  }
+  *ret = 0;
+  return true;
+}
+
+static bool flat_block(Flattener *fl, FlatFrame *f, uint32_t *ret) {
+  ASTBlock *block = f->node;
+  ASTStm *stm = f->iter;
+  if (f->step == 0) {
+    uint32_t n = 0;
+    for (stm = block ? block->head : NULL; stm; stm = stm->next)
+      n++;
+    f->ops = flat_extra(fl, n + 1);
+    flat_setextra(fl, f->ops, n);
+    stm = block ? block->head : NULL;
+  } else {
+    flat_setextra(fl, f->ops + 1 + f->i++, *ret);
+    stm = stm->next;
+  }
+  if (stm) {
+    f->iter = stm;
+    return flat_child(fl, f, 1, FLAT_WORK_STM, stm);
+  }
+  *ret = flat_node(fl, FLAT_BLOCK, 0, f->loc, f->ops, 0);
+  return true;
+}
+
+static bool flat_stm(Flattener *fl, FlatFrame *f, uint32_t *ret) {
+  ASTStm *stm = f->node;
+  if (!stm) {
+    *ret = 0;
+    return true;
+  }
+  switch (stm->type) {
+    case AST_STM_EXPR:
+      if (f->step == 0)
+        return flat_child(fl, f, 1, FLAT_WORK_EXPR, stm->val.expr);
+      *ret = flat_node(fl, FLAT_EXPR, 0, stm->loc, *ret, 0);
+      return true;
+    case AST_STM_LET: {
+      ASTLet *let = &stm->val.let;
+      switch (f->step) {
+        case 0:
+          f->ops = flat_extra(fl, 2);
+          return flat_child(fl, f, 1, FLAT_WORK_TYPE, let->type);
+        case 1:
+          flat_setextra(fl, f->ops, *ret);
+          return flat_child(fl, f, 2, FLAT_WORK_EXPR, let->initval);
+      }
+      flat_setextra(fl, f->ops + 1, *ret);
+      uint32_t name = flat_span(fl, let->name, let->nlen);
+      *ret = flat_node(fl, FLAT_LET, 0, stm->loc, name, f->ops);
+      return true;
+    }
+    case AST_STM_IFELSE: {
+      ASTIfElse *ifels = &stm->val.ifels;
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_EXPR, ifels->cond);
+        case 1:
+          f->lhs = *ret;
+          f->ops = flat_extra(fl, 2);
+          return flat_child(fl, f, 2, FLAT_WORK_STM, ifels->code);
+        case 2:
+          flat_setextra(fl, f->ops, *ret);
+          return flat_child(fl, f, 3, FLAT_WORK_STM, ifels->elsec);
+      }
+      flat_setextra(fl, f->ops + 1, *ret);
+      *ret = flat_node(fl, FLAT_IF, 0, stm->loc, f->lhs, f->ops);
+      return true;
+    }
+    case AST_STM_WHILE:
+      switch (f->step) {
+        case 0:
+          return flat_child(fl, f, 1, FLAT_WORK_EXPR, stm->val.whil.cond);
+        case 1:
+          f->lhs = *ret;
+          return flat_child(fl, f, 2, FLAT_WORK_STM, stm->val.whil.code);
+      }
+      *ret = flat_node(fl, FLAT_WHILE, 0, stm->loc, f->lhs, *ret);
+      return true;
+    case AST_STM_RETURN:
+      if (f->step == 0)
+        return flat_child(fl, f, 1, FLAT_WORK_EXPR, stm->val.retval);
+      *ret = flat_node(fl, FLAT_RETURN, 0, stm->loc, *ret, 0);
+      return true;
+    case AST_STM_BLOCK:
+      // the frame goes on as the block
+      f->work = FLAT_WORK_BLOCK;
+      f->node = stm->val.blck;
+      f->loc = stm->loc;
+      return flat_block(fl, f, ret);
+    case AST_STM_ERROR:
+      *ret = flat_node(fl, FLAT_ERROR, 0, stm->loc, 0, 0);
+      return true;
+  }
+  *ret = 0;
+  return true;
+}
+
+// flatten a subtree with an explicit stack, so deep nesting and long
+// chains of operators do not use up the call stack. loc is used when the
+// subtree is a block, returns the index of its node
+static uint32_t flat_walk(Flattener *fl, FlatWork work, void *node, SrcLoc loc) {
+  uint32_t ret = 0;
+  flat_push(fl, work, node);
+  if (fl->oom)
+    return 0;
+  fl->top->loc = loc;
+
+  while (fl->top && !fl->oom) {
+    FlatFrame *f = fl->top;
+    bool done = true;
+    switch (f->work) {
+      case FLAT_WORK_EXPR:   done = flat_expr(fl, f, &ret); break;
+      case FLAT_WORK_STM:    done = flat_stm(fl, f, &ret); break;
+      case FLAT_WORK_BLOCK:  done = flat_block(fl, f, &ret); break;
+      case FLAT_WORK_TYPE:   done = flat_type(fl, f, &ret); break;
+      case FLAT_WORK_PARAMS: done = flat_params(fl, f, &ret); break;
+    }
+    if (done)
+      flat_pop(fl);
+  }
+
+  // an allocation failure leaves frames behind
+  while (fl->top)
+    flat_pop(fl);
+  return fl->oom ? 0 : ret;
+}
+
+static uint32_t flat_decl(Flattener *fl, ASTDecl *decl) {
+  switch (decl->type) {
+    case AST_ROOT_FUNCDEF: {
+      ASTFuncDef *fn = decl->val.func;
+      uint32_t ops = flat_extra(fl, 3);
+      flat_setextra(fl, ops, flat_walk(fl, FLAT_WORK_TYPE, fn->rettype, SRCLOC_NONE));
+      flat_setextra(fl, ops + 1, flat_walk(fl, FLAT_WORK_BLOCK, fn->code, fn->loc));
+      flat_setextra(fl, ops + 2, flat_walk(fl, FLAT_WORK_PARAMS, fn->args, SRCLOC_NONE));
+      uint32_t name = flat_span(fl, fn->name, fn->nlen);
+      return flat_node(fl, FLAT_FUNC, 0, fn->loc, name, ops);
+    }
+    case AST_ROOT_ENUM: {
+      ASTEnum *en = decl->val.enumr;
+      uint32_t n = 0;
+      for (ASTEnumEntry *ent = en->head; ent; ent = ent->next)
+        n++;
+      uint32_t ops = flat_extra(fl, n + 2);
+      flat_setextra(fl, ops, flat_walk(fl, FLAT_WORK_TYPE, en->type, SRCLOC_NONE));
+      flat_setextra(fl, ops + 1, n);
+      uint32_t i = 0;
+      for (ASTEnumEntry *ent = en->head; ent; ent = ent->next) {
+        uint32_t val = flat_walk(fl, FLAT_WORK_EXPR, ent->cnst, SRCLOC_NONE);
+        uint32_t name = flat_span(fl, ent->name, ent->nlen);
+        flat_setextra(fl, ops + 2 + i++,
+            flat_node(fl, FLAT_ENTRY, 0, ent->loc, name, val));
+      }
+      uint32_t name = flat_span(fl, en->name, en->nlen);
+      return flat_node(fl, FLAT_ENUM, 0, en->loc, name, ops);
+    }
+    case AST_ROOT_TALIAS: {
+      ASTTypeAlias *ta = decl->val.talias;
+      uint32_t type = flat_walk(fl, FLAT_WORK_TYPE, ta->type, SRCLOC_NONE);
+      uint32_t name = flat_span(fl, ta->name, ta->nlen);
+      return flat_node(fl, FLAT_TALIAS, 0, ta->loc, name, type);
+    }
+    case AST_ROOT_ERROR:
+      return flat_node(fl, FLAT_ERROR, 0, decl->val.err, 0, 0);
+  }
+  return 0;
+}
+
+int flat_build(FlatAST *ast, ASTRoot *root) {
+  if (!ast || !root)
+    return 1;
+  memset(ast, 0, sizeof(FlatAST));
+  Flattener fl = { ast, false, NULL, NULL };
+
+  // index 0 of the nodes, extras and spans means none
+  flat_node(&fl, FLAT_NONE, 0, SRCLOC_NONE, 0, 0);
+  flat_extra(&fl, 1);
+  flat_span(&fl, "", 0);
+
+  uint32_t n = 0;
+  for (ASTDecl *decl = root->head; decl; decl = decl->next)
+    n++;
+  uint32_t list = flat_extra(&fl, n + 1);
+  flat_setextra(&fl, list, n);
+  uint32_t i = 0;
+  for (ASTDecl *decl = root->head; decl; decl = decl->next)
+    flat_setextra(&fl, list + 1 + i++, flat_decl(&fl, decl));
+  ast->root = flat_node(&fl, FLAT_ROOT, 0, SRCLOC_NONE, list, 0);
+
+  while (fl.spare) {
+    FlatFrame *next = fl.spare->next;
+    free(fl.spare);
+    fl.spare = next;
+  }
+
+  if (fl.oom) {
+    fprintf(stderr, "znc: out of memory\n");
+    flat_free(ast);
+    return 1;
+  }
+  return 0;
+}
+
+void flat_free(FlatAST *ast) {
+  if (!ast)
+    return;
+  // a loaded blob is owned by the caller
+  if (!ast->blob) {
+    free(ast->kind);
+    free(ast->sub);
+    free(ast->loc);
+    free(ast->data);
+    free(ast->extra);
+    free(ast->nums);
+    free(ast->spans);
+    free(ast->bytes);
+  }
+  memset(ast, 0, sizeof(FlatAST));
+}
+
+// offsets of the arrays in a blob, the wider elements go first so each
+// array is aligned. returns the size of the blob
+static uvar flat_layout(FlatHeader *hdr, uvar off[8]) {
+  uvar pos = sizeof(FlatHeader);
+  off[0] = pos; pos += sizeof(uint64_t) * hdr->ncnt;  // nums
+  off[1] = pos; pos += sizeof(FlatData) * hdr->cnt;   // data
+  off[2] = pos; pos += sizeof(FlatSpan) * hdr->scnt;  // spans
+  off[3] = pos; pos += sizeof(SrcLoc) * hdr->cnt;     // loc
+  off[4] = pos; pos += sizeof(uint32_t) * hdr->ecnt;  // extra
+  off[5] = pos; pos += hdr->cnt;                      // kind
+  off[6] = pos; pos += hdr->cnt;                      // sub
+  off[7] = pos; pos += hdr->bcnt;                     // bytes
+  return pos;
+}
+
+int flat_write(FlatAST *ast, FILE *out) {
+  if (!ast || !out)
+    return 1;
+  FlatHeader hdr;
+  memcpy(hdr.magic, FLAT_MAGIC, 4);
+  hdr.version = FLAT_VERSION;
+  hdr.cnt  = ast->cnt;
+  hdr.ecnt = ast->ecnt;
+  hdr.ncnt = ast->ncnt;
+  hdr.scnt = ast->scnt;
+  hdr.bcnt = ast->bcnt;
+  hdr.root = ast->root;
+
+  uvar off[8];
+  flat_layout(&hdr, off);
+  bool fail = false;
+  fail |= fwrite(&hdr, sizeof(hdr), 1, out) != 1;
+  fail |= fwrite(ast->nums, sizeof(uint64_t), hdr.ncnt, out) != hdr.ncnt;
+  fail |= fwrite(ast->data, sizeof(FlatData), hdr.cnt, out) != hdr.cnt;
+  fail |= fwrite(ast->spans, sizeof(FlatSpan), hdr.scnt, out) != hdr.scnt;
+  fail |= fwrite(ast->loc, sizeof(SrcLoc), hdr.cnt, out) != hdr.cnt;
+  fail |= fwrite(ast->extra, sizeof(uint32_t), hdr.ecnt, out) != hdr.ecnt;
+  fail |= fwrite(ast->kind, 1, hdr.cnt, out) != hdr.cnt;
+  fail |= fwrite(ast->sub, 1, hdr.cnt, out) != hdr.cnt;
+  fail |= fwrite(ast->bytes, 1, hdr.bcnt, out) != hdr.bcnt;
+  return fail;
+}
+
+int flat_load(FlatAST *ast, void *blob, uvar size) {
+  if (!ast || !blob || size < sizeof(FlatHeader) || (uintptr_t)blob % 8)
+    return 1;
+  FlatHeader *hdr = (FlatHeader*)blob;
+  if (memcmp(hdr->magic, FLAT_MAGIC, 4) != 0 || hdr->version != FLAT_VERSION)
+    return 1;
+
+  uvar off[8];
+  if (flat_layout(hdr, off) > size || hdr->root >= hdr->cnt)
+    return 1;
+
+  char *base = (char*)blob;
+  memset(ast, 0, sizeof(FlatAST));
+  ast->nums  = (uint64_t*)(base + off[0]);
+  ast->data  = (FlatData*)(base + off[1]);
+  ast->spans = (FlatSpan*)(base + off[2]);
+  ast->loc   = (SrcLoc*)(base + off[3]);
+  ast->extra = (uint32_t*)(base + off[4]);
+  ast->kind  = (uint8_t*)(base + off[5]);
+  ast->sub   = (uint8_t*)(base + off[6]);
+  ast->bytes = base + off[7];
+  ast->cnt   = hdr->cnt;
+  ast->ecnt  = hdr->ecnt;
+  ast->ncnt  = hdr->ncnt;
+  ast->scnt  = hdr->scnt;
+  ast->bcnt  = hdr->bcnt;
+  ast->root  = hdr->root;
+  ast->blob  = blob;
+  return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef _ZNC_FLAT_H
+#define _ZNC_FLAT_H
+#include "types.h"
+#include "srcmgr.h"
+#include "ast.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// the flat form of the ast. nodes live in parallel arrays addressed by
+// 32-bit indices, children come before their parents (post-order) so a
+// pass that only needs the children done first is a plain loop. nothing
+// points outside the arrays, the whole tree can be written out and
+// mapped back as one blob
+//
+// every node has a kind, a sub (operator, keyword or flag), a location
+// and two operands lhs and rhs. operands are node indices unless noted,
+// index 0 is the none node. lists and the operands that do not fit are
+// kept in the extra array, a list is its length followed by the items:
+//
+//   kind          sub       lhs                 rhs
+//   FLAT_IDENT    -         name                -
+//   FLAT_STRING   -         decoded bytes       -
+//   FLAT_ARRAY    -         extra: list         -
+//   FLAT_INT      -         nums: value         -
+//   FLAT_BIGINT   -         bytes: limbs        -
+//   FLAT_FLOAT    -         nums: value bits    -
+//   FLAT_UNOP     op        operand             1 if prefix
+//   FLAT_BINOP    op        left                right
+//   FLAT_TERNOP   op        cond                extra: middle, right
+//   FLAT_CALL     -         callee              extra: list of args
+//   FLAT_ARG      -         value               name of a kwarg, or 0
+//   FLAT_CAST     -         type                value
+//   FLAT_EXPR     -         expr                -
+//   FLAT_LET      -         name                extra: type, init
+//   FLAT_IF       -         cond                extra: then, else
+//   FLAT_WHILE    -         cond                body
+//   FLAT_RETURN   -         value               -
+//   FLAT_BLOCK    -         extra: list         -
+//   FLAT_PARAM    rest      name                extra: type, default
+//   FLAT_FUNC     -         name                extra: ret, body, params (a list)
+//   FLAT_ENTRY    -         name                value
+//   FLAT_ENUM     -         name                extra: type, list of entries
+//   FLAT_TALIAS   -         name                type
+//   FLAT_TPRIM    keyword   -                   -
+//   FLAT_TARRAY   -         element             -
+//   FLAT_TFUNC    -         return              extra: params (a list)
+//   FLAT_TNAME    -         name                -
+//   FLAT_ERROR    -         -                   -
+//   FLAT_ROOT     -         extra: list         -
+//
+// names and decoded bytes are spans of the bytes array, span 0 is empty
+
+typedef enum {
+  FLAT_NONE = 0,
+  FLAT_IDENT,
+  FLAT_STRING,
+  FLAT_ARRAY,
+  FLAT_INT,
+  FLAT_BIGINT,
+  FLAT_FLOAT,
+  FLAT_UNOP,
+  FLAT_BINOP,
+  FLAT_TERNOP,
+  FLAT_CALL,
+  FLAT_ARG,
+  FLAT_CAST,
+  FLAT_EXPR,
+  FLAT_LET,
+  FLAT_IF,
+  FLAT_WHILE,
+  FLAT_RETURN,
+  FLAT_BLOCK,
+  FLAT_PARAM,
+  FLAT_FUNC,
+  FLAT_ENTRY,
+  FLAT_ENUM,
+  FLAT_TALIAS,
+  FLAT_TPRIM,
+  FLAT_TARRAY,
+  FLAT_TFUNC,
+  FLAT_TNAME,
+  FLAT_ERROR,
+  FLAT_ROOT,
+} FlatKind;
+
+typedef struct {
+  uint32_t lhs;
+  uint32_t rhs;
+} FlatData;
+
+typedef struct {
+  uint32_t off;         /* offset in bytes */
+  uint32_t len;         /* length of the span */
+} FlatSpan;
+
+typedef struct FlatAST {
+  uint8_t *kind;        /* FlatKind of the nodes */
+  uint8_t *sub;         /* operator, keyword or flag of the nodes */
+  SrcLoc *loc;          /* location of the nodes */
+  FlatData *data;       /* operands of the nodes */
+  uint32_t cnt;         /* number of nodes */
+  uint32_t alloc;
+
+  uint32_t *extra;      /* lists and extra operands */
+  uint32_t ecnt;
+  uint32_t ealloc;
+
+  uint64_t *nums;       /* integer values and float bits */
+  uint32_t ncnt;
+  uint32_t nalloc;
+
+  FlatSpan *spans;      /* names and decoded strings */
+  uint32_t scnt;
+  uint32_t salloc;
+
+  char *bytes;          /* text of the spans and limbs of big integers */
+  uint32_t bcnt;
+  uint32_t balloc;
+
+  uint32_t root;        /* the FLAT_ROOT node */
+  void *blob;           /* the blob the arrays point into, or NULL */
+} FlatAST;
+
+/* flatten a tree, returns 0 if succeded */
+int flat_build(FlatAST *ast, ASTRoot *root);
+
+/* free a flat ast */
+void flat_free(FlatAST *ast);
+
+/* get a span of the bytes */
+#define flat_text(ast, span) ((ast)->bytes + (ast)->spans[span].off)
+
+/* write the arrays as one blob, returns 0 if succeded */
+int flat_write(FlatAST *ast, FILE *out);
+
+/* use a blob written by flat_write() in place, it must be aligned to 8
+   bytes and stay valid until flat_free(). returns 0 if succeded */
+int flat_load(FlatAST *ast, void *blob, uvar size);
+
+#endif // _ZNC_FLAT_H
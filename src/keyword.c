@@ -1,6 +1,7 @@
 #include "keyword.h"
 #include "types.h"
 #include <string.h>
+#include <ctype.h>
 
 const char *KeywordNames[] = {
   [KWD_UNK]             = "<unknown>",
@@ -20,23 +21,84 @@ const char *KeywordNames[] = {
   "float", "double", "char", "bool",
 };
 
-uvar iskwd(char *text) {
-  for (int i = 1; i < sizeof(KeywordNames) / sizeof(char*); i++) {
-    uvar len = strlen(KeywordNames[i]);
-    if (strncmp(text, KeywordNames[i], len) == 0)
-      return len;
+// compare the probed text against one candidate keyword, the length is
+// already known to match at this point
+#define KWD_TRY(kwd) \
+  if (memcmp(text, KeywordNames[kwd], len) == 0) return kwd
+
+KeywordType findkwd(char *text, uvar len) {
+  if (!text) return KWD_UNK;
+
+  // the length and first char picks at most two candidates
+  switch (len) {
+    case 2:
+      if (text[0] == 'i') { KWD_TRY(KWD_IF); }
+      break;
+
+    case 3:
+      switch (text[0]) {
+        case 'l': KWD_TRY(KWD_LET); break;
+        case 'i': KWD_TRY(KWD_INT); break;
+      }
+      break;
+
+    case 4:
+      switch (text[0]) {
+        case 'e': KWD_TRY(KWD_ELSE); KWD_TRY(KWD_ENUM); break;
+        case 'b': KWD_TRY(KWD_BYTE); KWD_TRY(KWD_BOOL); break;
+        case 't': KWD_TRY(KWD_TYPE); break;
+        case 'l': KWD_TRY(KWD_LONG); break;
+        case 'u': KWD_TRY(KWD_UINT); break;
+        case 'c': KWD_TRY(KWD_CHAR); break;
+      }
+      break;
+
+    case 5:
+      switch (text[0]) {
+        case 'w': KWD_TRY(KWD_WHILE); break;
+        case 's': KWD_TRY(KWD_SHORT); break;
+        case 'u': KWD_TRY(KWD_UBYTE); KWD_TRY(KWD_ULONG); break;
+        case 'f': KWD_TRY(KWD_FLOAT); break;
+      }
+      break;
+
+    case 6:
+      switch (text[0]) {
+        case 'r': KWD_TRY(KWD_RETURN); break;
+        case 'u': KWD_TRY(KWD_USHORT); break;
+        case 'd': KWD_TRY(KWD_DOUBLE); break;
+      }
+      break;
+
+    case 8:
+      if (text[0] == 'f') { KWD_TRY(KWD_FUNCTION); }
+      break;
   }
-  return 0;
+
+  return KWD_UNK;
+}
+
+#undef KWD_TRY
+
+// length of the identifier-like run at text
+static uvar kwdspan(char *text) {
+  uvar len = 0;
+  while (isalnum((unsigned char)text[len]) || text[len] == '_')
+    len++;
+  return len;
+}
+
+uvar iskwd(char *text) {
+  if (!text) return 0;
+  uvar len = kwdspan(text);
+  return findkwd(text, len) != KWD_UNK ? len : 0;
 }
 
 KeywordType getkwd(char *text) {
-  for (int i = 1; i < sizeof(KeywordNames) / sizeof(char*); i++)
-    if (strncmp(text, KeywordNames[i], strlen(KeywordNames[i])) == 0)
-      return i;
-  return KWD_UNK;
+  if (!text) return KWD_UNK;
+  return findkwd(text, kwdspan(text));
 }
 
 int iskwdprim(KeywordType kwd) {
   return KWD_BYTE <= kwd && KWD_BOOL >= kwd;
 }
-
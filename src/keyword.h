@@ -32,7 +32,10 @@ typedef enum {
 // keywords
 extern const char *KeywordNames[];
 
-/* returns the length of the keyword if it is on the KeywordNames, zero otheewise */
+/* returns the keyword type of exactly len chars of text, KWD_UNK otherwise */
+KeywordType findkwd(char *text, uvar len);
+
+/* returns the length of the keyword if the word at text is one, zero otherwise */
 uvar iskwd(char *text);
 
 /* get the keyword type from given string */
@@ -1,39 +1,71 @@
 #include "lexer.h"
+#include "operator.h"
+#include "keyword.h"
+#include "pipeline.h"
+#include "memstat.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdarg.h>
 
-int lexer_init(Lexer *lex, char *name, char *src) {
-  if (!lex)
-    return 1;
+// set up a lexer for an input, all but the token array
+static int lexer_setup(Lexer *lex, char *name, char *src) {
   // general
   lex->name  = name;
   lex->input = src;
   lex->lex   = src;
   lex->len   = strlen(src);
   lex->eof   = false;
+  if (lex->len > LEXER_MAXINPUT)
+    return 1;
 
-  // counters
-  lex->line  = 1;
-  lex->col   = 1;
-  lex->pos   = 0;
+  // give the input its range of source locations
+  lex->src = src_add(name, src, lex->len);
+  if (!lex->src)
+    return 1;
 
   // token trackers
+  lex->stream = false;
+  lex->quiet  = false;
+  lex->mute   = 0;
+  lex->depth  = 0;
+  lex->rdepth = 0;
+  lex->maxdepth = LEXER_MAXDEPTH;
+  lex->nerrs  = 0;
+  lex->maxerrs = LEXER_MAXERRS;
+  lex->pipe   = NULL;
   lex->pind  = 0;
+  lex->tcnt  = 0;
+  return 0;
+}
+
+int lexer_init(Lexer *lex, char *name, char *src) {
+  if (!lex)
+    return 1;
+  lex->toks   = NULL;
+  lex->talloc = 0;
+  if (lexer_setup(lex, name, src))
+    return 1;
   lex->toks  = (Token*)malloc(sizeof(Token));
   if (!lex->toks)
     return 1;
   lex->talloc = 1;
-  lex->tcnt  = 0;
-
   return 0;
 }
 
+int lexer_reset(Lexer *lex, char *name, char *src) {
+  if (!lex || !lex->toks)
+    return 1;
+  lexer_endpipeline(lex);
+  return lexer_setup(lex, name, src);
+}
+
 void lexer_free(Lexer *lex) {
   if (!lex)
     return;
+  // the lexer thread may still be reading the input
+  lexer_endpipeline(lex);
   lex->name  = NULL;
   lex->input = NULL;
   lex->lex   = NULL;
@@ -41,32 +73,72 @@ void lexer_free(Lexer *lex) {
     free(lex->toks);
     lex->toks = NULL;
   }
+  // the buffer stays in the source manager, locations into it
+  // may outlive the lexer
+  lex->src = NULL;
   return;
 }
 
 void lexer_inc(Lexer *lex) {
   if (!lex || lex->eof)
     return;
+  lex->lex++;
+  return;
+}
 
-  // increment counters based on chars
-  lex->pos++;
-  switch (*lex->lex++) {
-    case '\r':
-      lex->col = 1;
-      break;
-    case '\n':
-      lex->col = 1;
-      lex->line++;
-      break;
-    case '\t':
-      // +1 because col starts at 1
-      lex->col += 8 - (lex->col % 8) + 1;
-      break;
-    default:
-      lex->col++;
-  }
+int lexer_getloc(Lexer *lex, uvar pos, uvar *line, uvar *col) {
+  if (!lex || !lex->src)
+    return 1;
+  if (pos > lex->len)
+    pos = lex->len;
+  return src_getloc(lex->src->base + pos, NULL, line, col);
+}
 
-  return;
+int lexer_resize(Lexer *lex, uvar n) {
+  if (!lex || n == 0)
+    return 1;
+  Token *tmp = (Token*)realloc(lex->toks, sizeof(Token) * n);
+  if (!tmp)
+    return 1;
+  lex->toks   = tmp;
+  lex->talloc = n;
+  memstat_add(tokgrows, 1);
+  memstat_max(&MemStat.tokbytes, sizeof(Token) * n);
+  return 0;
+}
+
+int lexer_setwindow(Lexer *lex, uvar size) {
+  if (!lex || lex->tcnt > 0 || size < LEXER_MINWINDOW)
+    return 1;
+
+  // the ring is indexed with a mask, round up to a power of two
+  uvar ring = LEXER_MINWINDOW;
+  while (ring < size) ring *= 2;
+
+  if (lexer_resize(lex, ring))
+    return 1;
+  lex->stream = true;
+  return 0;
+}
+
+int lexer_tokenize_all(Lexer *lex) {
+  if (!lex || lex->stream || lex->pipe)
+    return 1;
+
+  // reserve once from the input size, a token every few bytes is the
+  // usual density. the array still grows if the guess was short
+  uvar want = lex->tcnt + lex->len / LEXER_BYTESPERTOK + 2;
+  if (lex->talloc < want && lexer_resize(lex, want))
+    return 1;
+
+  while (!lex->eof)
+    lexer_scan(lex, (uvar)-1);
+  return 0;
+}
+
+// get the slot of the nth emitted token
+static Token *lexer_tokat(Lexer *lex, uvar idx) {
+  return &lex->toks[lex->stream ? idx & (lex->talloc - 1) : idx];
 }
 
 void lexer_emit(Lexer *lex, Token *tok) {
@@ -77,27 +149,16 @@ void lexer_emit(Lexer *lex, Token *tok) {
   if (lex->eof)
     return;
 
-  // the list is full, re-allocate it!
-  if (lex->talloc <= lex->tcnt) {
-    Token *tmp = (Token*)realloc(lex->toks, sizeof(Token) * lex->talloc * 2);
-    if (!tmp) {
-      fprintf(stderr, "znc: out of memory\n");
-      lex->eof = true;
-      return;
-    }
-    lex->toks = tmp;
-    lex->talloc *= 2;
+  // the list is full, re-allocate it! (the ring just wraps around)
+  if (!lex->stream && lex->talloc <= lex->tcnt &&
+      lexer_resize(lex, lex->talloc * 2)) {
+    fprintf(stderr, "znc: out of memory\n");
+    lex->eof = true;
+    return;
   }
 
   // copy tok into the list
-  Token *out = &lex->toks[lex->tcnt++];
-  out->lexer  = lex;
-  out->type   = tok->type;
-  out->lexeme = tok->lexeme;
-  out->len    = tok->len;
-  out->line   = tok->line;
-  out->col    = tok->col;
-  out->pos    = tok->pos;
+  *lexer_tokat(lex, lex->tcnt++) = *tok;
   return;
 }
 
@@ -105,6 +166,10 @@ Token *lexer_consume(Lexer *lex) {
   if (!lex)
     return NULL;
 
+  // already tokenized, the usual case after lexer_tokenize_all()
+  if (!lex->stream && lex->pind < lex->tcnt)
+    return &lex->toks[lex->pind++];
+
   // process next tokens if needed
   while (lex->tcnt <= lex->pind && !lex->eof)
     lexer_tokenize(lex);
@@ -112,11 +177,11 @@ Token *lexer_consume(Lexer *lex) {
   // maybe eof?
   if (lex->tcnt <= lex->pind) {
     if (!lex->eof) return NULL;
-    return &lex->toks[lex->tcnt - 1];
+    return lexer_tokat(lex, lex->tcnt - 1);
   }
 
   // return the requested token
-  return &lex->toks[lex->pind++];
+  return lexer_tokat(lex, lex->pind++);
 }
 
 Token *lexer_peek(Lexer *lex, var offst) {
@@ -131,6 +196,14 @@ Token *lexer_peek(Lexer *lex, var offst) {
   if (offst < 1 && lex->pind < absp)
     return NULL;
 
+  // already tokenized
+  if (!lex->stream && absp < lex->tcnt)
+    return &lex->toks[absp];
+
+  // already dropped from the token window
+  if (lex->stream && absp + lex->talloc < lex->tcnt)
+    return NULL;
+
   // process next tokens if not enough
   while (lex->tcnt <= absp && !lex->eof)
     lexer_tokenize(lex);
@@ -138,11 +211,11 @@ Token *lexer_peek(Lexer *lex, var offst) {
   // lexer_tokenize() didn't reached the target position, eof?
   if (lex->tcnt <= absp) {
     if (!lex->eof) return NULL;
-    return &lex->toks[lex->tcnt - 1];
+    return lexer_tokat(lex, lex->tcnt - 1);
   }
 
   // the requested token
-  return &lex->toks[absp];
+  return lexer_tokat(lex, absp);
 }
 
 void lexer_seek(Lexer *lex, var offst) {
@@ -152,19 +225,37 @@ void lexer_seek(Lexer *lex, var offst) {
   return;
 }
 
-void print_token(Token *tok, const char *msg, ...) {
-  if (!tok || !msg)
+SrcLoc tokloc(Lexer *lex, Token *tok) {
+  if (!lex || !tok)
+    return SRCLOC_NONE;
+  return lex->src->base + tok->pos;
+}
+
+// print a diagnostic at a source location, a len of (uvar)-1 underlines
+// the token found there
+static void vprint_loc(Lexer *lex, SrcLoc loc, uvar ulen, const char *msg, va_list args) {
+  if (lex->quiet || lex->mute)
     return;
 
+  // resolve the location
+  SrcBuffer *buf = NULL;
+  uvar line = 0, col = 0;
+  if (src_getloc(loc, &buf, &line, &col)) {
+    printf("znc: ");
+    vprintf(msg, args);
+    return;
+  }
+  char *text = buf->text;
+  uvar pos = loc - buf->base;
+  if (ulen == (uvar)-1)
+    ulen = lexer_spanat(text + pos);
+
   // message
-  printf("%s:%u:%u: ", tok->lexer->name, tok->line, tok->col);
-  va_list args;
-  va_start(args, msg);
+  printf("%s:%lu:%lu: ", buf->name, (unsigned long)line, (unsigned long)col);
   vprintf(msg, args);
-  va_end(args);
 
   // get the line number print length
-  uvar lntmp = tok->line;
+  uvar lntmp = line;
   uvar len = 0;
   do {
     len++;
@@ -172,12 +263,12 @@ void print_token(Token *tok, const char *msg, ...) {
   } while (lntmp != 0);
 
   // now, find the start of the line
-  char *lstart = tok->lexeme;
-  while (tok->lexer->input < lstart && *(lstart - 1) != '\n')
+  char *lstart = text + pos;
+  while (text < lstart && *(lstart - 1) != '\n')
     lstart--;
 
   // print!
-  printf("  %u | ", tok->line);
+  printf("  %lu | ", (unsigned long)line);
   uvar currCol = 0;
   while (*lstart != '\r' && *lstart != '\n' && *lstart != '\0') {
     char ch = *lstart++;
@@ -202,37 +293,71 @@ void print_token(Token *tok, const char *msg, ...) {
   for (int i = 0; i < len; i++)
     fputc(' ', stdout);
   printf(" | ");
-  for (int i = 0; i < tok->col - 1; i++)
+  for (int i = 0; i < col - 1; i++)
     fputc(' ', stdout);
-  for (int i = 0; i < tok->len; i++)
+  for (uvar i = 0; i < ulen; i++)
     fputc('^', stdout);
   fputc('\n', stdout);
 }
 
-int expect_token(Token *tok, TokenType type, char *text) {
+void print_token(Lexer *lex, Token *tok, const char *msg, ...) {
+  if (!lex || !tok || !msg)
+    return;
+  va_list args;
+  va_start(args, msg);
+  vprint_loc(lex, tokloc(lex, tok), lexer_toklen(lex, tok), msg, args);
+  va_end(args);
+}
+
+void print_loc(Lexer *lex, SrcLoc loc, const char *msg, ...) {
+  if (!lex || !msg)
+    return;
+  va_list args;
+  va_start(args, msg);
+  vprint_loc(lex, loc, (uvar)-1, msg, args);
+  va_end(args);
+}
+
+void print_span(Lexer *lex, SrcLoc loc, uvar len, const char *msg, ...) {
+  if (!lex || !msg)
+    return;
+  va_list args;
+  va_start(args, msg);
+  vprint_loc(lex, loc, len, msg, args);
+  va_end(args);
+}
+
+// printable text of a token sub-kind
+static const char *token_subname(TokenType type, int sub) {
+  switch (type) {
+    case TOKEN_OPERATOR:  return OperatorNames[sub];
+    case TOKEN_KEYWORD:   return KeywordNames[sub];
+    case TOKEN_BRACKET:
+    case TOKEN_DELIMETER: return PunctNames[sub];
+    default:              return NULL;
+  }
+}
+
+int expect_token(Lexer *lex, Token *tok, TokenType type, int sub) {
   if (!tok)
     return 1;
-  if (cmp_token(tok, type, text))
+  if (cmp_token(tok, type, sub))
     return 0;
 
   if (tok->type == TOKEN_ERROR)
     return 1; // the tokenizer already printed the error
   if (tok->type == TOKEN_EOF)
-    print_token(tok, "syntax error: unexpected end of input\n");
-  else if (text)
-    print_token(tok, "syntax error: expected '%s'\n", text);
+    print_token(lex, tok, "syntax error: unexpected end of input\n");
+  else if (sub && token_subname(type, sub))
+    print_token(lex, tok, "syntax error: expected '%s'\n", token_subname(type, sub));
   else
-    print_token(tok, "syntax error: unexpected token\n");
+    print_token(lex, tok, "syntax error: unexpected token\n");
 
   return 1;
 }
 
-int cmp_token(Token *tok, TokenType type, char *text) {
+int cmp_token(Token *tok, TokenType type, int sub) {
   if (!tok)
     return 0;
-  return tok->type == type && (text
-     ? strncmp(text, tok->lexeme, tok->len) == 0
-     : 1
-  );
+  return tok->type == type && (!sub || tok->sub == sub);
 }
-
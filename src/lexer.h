@@ -2,20 +2,45 @@
 #define _ZNC_LEXER_H
 #include "types.h"
 #include "token.h"
+#include "srcmgr.h"
 #include <stdbool.h>
+#include <stdint.h>
 
-typedef struct {
-  struct Lexer *lexer;  /* ptr to the source lexer */
+// smallest token window of the streaming mode, the parser looks at
+// most two tokens ahead and one behind
+#define LEXER_MINWINDOW 16
+
+// lower bound of source bytes per token in real code, lexer_tokenize_all()
+// reserves the token array from it so it rarely has to grow
+#define LEXER_BYTESPERTOK 2
+
+// stored length of tokens that are too long for the len field, use
+// lexer_toklen() to get the real length
+#define TOKEN_LONGLEN UINT16_MAX
+
+// default nesting limit of the parser (see Lexer.maxdepth)
+#define LEXER_MAXDEPTH 4096
+
+// nesting limit of what the parser still recurses into (parentheses,
+// casts, subscripts, function types), whatever Lexer.maxdepth is. it
+// keeps the parser well inside the usual 8 MiB stack
+#define LEXER_MAXRECURSE 8192
+
+// default number of syntax errors after which the parser stops
+#define LEXER_MAXERRS 20
 
-  TokenType type;       /* type of the token */
-  char *lexeme;         /* token text string view */
+// largest input a lexer accepts, token offsets are 32-bit
+#define LEXER_MAXINPUT UINT32_MAX
 
-  uvar len;             /* length of the token */
-  uvar line;            /* line loc of the token */
-  uvar col;             /* col loc of the token */
-  uvar pos;             /* pos loc of the token */
+typedef struct {
+  uint32_t pos;         /* byte offset of the token */
+  uint16_t len;         /* length of the token (see TOKEN_LONGLEN) */
+  uint8_t type;         /* TokenType of the token */
+  uint8_t sub;          /* OperatorType, KeywordType or PunctType of the token */
 } Token;
 
+struct LexPipe;
+
 typedef struct Lexer {
   char *name;           /* name of the lexer */
 
@@ -24,25 +49,47 @@ typedef struct Lexer {
   uvar len;             /* length of input */
   bool eof;             /* whether the lexer has reached the end of input */
 
-  uvar line;            /* current line */
-  uvar col;             /* current col */
-  uvar pos;             /* current pos */
+  SrcBuffer *src;       /* the input in the source manager */
 
   uvar pind;            /* lexer position indicator (to next token) */
-  Token *toks;          /* array of tokens */
+  Token *toks;          /* array of tokens (a ring in streaming mode) */
   uvar talloc;          /* allocation size of toks */
   uvar tcnt;            /* number of emitted tokens */
+  bool stream;          /* whether only a window of tokens is kept */
+  bool quiet;           /* do not print diagnostics */
+  uvar mute;            /* depth of speculative parses, their diagnostics are dropped */
+  uvar depth;           /* nesting depth of the parser */
+  uvar rdepth;          /* part of depth the parser recursed into */
+  uvar maxdepth;        /* nesting limit of the parser, 0 for none */
+  uvar nerrs;           /* syntax errors found by the parser */
+  uvar maxerrs;         /* error limit of the parser, 0 for none */
+  struct LexPipe *pipe; /* lexer thread of the pipelined mode, or NULL */
 } Lexer;
 
 /* initialize a lexer */
 int lexer_init(Lexer *lex, char *name, char *src);
 
+/* re-initialize a lexer for another input, keeping its token array */
+int lexer_reset(Lexer *lex, char *name, char *src);
+
 /* free a lexer context */
 void lexer_free(Lexer *lex);
 
 /* increment the lexer counter */
 void lexer_inc(Lexer *lex);
 
+/* resize the token array to n tokens, returns 0 if succeded */
+int lexer_resize(Lexer *lex, uvar n);
+
+/* switch to streaming mode, keeping only the last size (rounded up to a
+   power of two) tokens. must be called before any token is processed,
+   returns 0 if succeded */
+int lexer_setwindow(Lexer *lex, uvar size);
+
+/* tokenize the whole input at once into a token array reserved from the
+   input size. not available in streaming mode, returns 0 if succeded */
+int lexer_tokenize_all(Lexer *lex);
+
 /* emit a token */
 void lexer_emit(Lexer *lex, Token *tok);
 
@@ -55,17 +102,44 @@ Token *lexer_peek(Lexer *lex, var offst);
 /* move the position indicator */
 void lexer_seek(Lexer *lex, var offst);
 
+/* resolve the line and col of a byte offset, returns 0 if succeded */
+int lexer_getloc(Lexer *lex, uvar pos, uvar *line, uvar *col);
+
+/* get the text of a token */
+#define toktext(lex, tok) ((lex)->input + (tok)->pos)
+
+/* get the length of a token, re-measures long tokens */
+uvar lexer_toklen(Lexer *lex, Token *tok);
+
+/* get the length of the token that starts at text */
+uvar lexer_spanat(char *text);
+
+/* get the global location of a token */
+SrcLoc tokloc(Lexer *lex, Token *tok);
+
 /* print a token */
-void print_token(Token *tok, const char *msg, ...);
+void print_token(Lexer *lex, Token *tok, const char *msg, ...);
+
+/* print a message at a location, underlining the token found there */
+void print_loc(Lexer *lex, SrcLoc loc, const char *msg, ...);
+
+/* print a message at a location, underlining len chars */
+void print_span(Lexer *lex, SrcLoc loc, uvar len, const char *msg, ...);
 
 /* expect a token, returns 0 if succeded, 1 otherwise */
-int expect_token(Token *tok, TokenType type, char *text);
+int expect_token(Lexer *lex, Token *tok, TokenType type, int sub);
 
-/* compare token to given type and text, returns true if match */
-int cmp_token(Token *tok, TokenType type, char *text);
+/* compare token to given type and sub-kind (0 matches any), returns true if match */
+int cmp_token(Token *tok, TokenType type, int sub);
 
 /* process next tokens */
 void lexer_tokenize(Lexer *lex);
 
+/* process up to max tokens, returns how many were emitted */
+uvar lexer_scan(Lexer *lex, uvar max);
+
+/* print the diagnostic of an error token */
+void lexer_report(Lexer *lex, Token *tok);
+
 #endif // _ZNC_LEXER_H
 
@@ -1,44 +1,140 @@
 #include "util.h"
 #include "lexer.h"
+#include "parlex.h"
+#include "pipeline.h"
 #include "ast.h"
 #include "arena.h"
+#include "memstat.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
 
 int main(int argc, char **argv) {
-  if (argc < 2) {
+  char *path = NULL;
+  bool stream = false;
+  bool lazy = false;
+  bool parallel = false;
+  bool pipeline = false;
+  bool memstats = false;
+  bool memjson = false;
+  bool vmarena = false;
+  bool hugepages = false;
+  uvar maxdepth = LEXER_MAXDEPTH;
+  uvar maxerrs = LEXER_MAXERRS;
+
+  // process args
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stream") == 0)
+      stream = true;
+    else if (strcmp(argv[i], "--lazy") == 0)
+      lazy = true;
+    else if (strcmp(argv[i], "--parallel") == 0)
+      parallel = true;
+    else if (strcmp(argv[i], "--pipeline") == 0)
+      pipeline = true;
+    else if (strcmp(argv[i], "--mem-stats") == 0)
+      memstats = true;
+    else if (strcmp(argv[i], "--mem-stats=json") == 0)
+      memstats = memjson = true;
+    else if (strcmp(argv[i], "--vm-arena") == 0)
+      vmarena = true;
+    else if (strcmp(argv[i], "--vm-arena=huge") == 0)
+      vmarena = hugepages = true;
+    else if (strncmp(argv[i], "--max-depth=", 12) == 0) {
+      char *end;
+      maxdepth = strtoul(argv[i] + 12, &end, 10);
+      if (end == argv[i] + 12 || *end) {
+        fprintf(stderr, "znc: invalid nesting limit: %s\n", argv[i] + 12);
+        return 1;
+      }
+    }
+    else if (strncmp(argv[i], "--max-errors=", 13) == 0) {
+      char *end;
+      maxerrs = strtoul(argv[i] + 13, &end, 10);
+      if (end == argv[i] + 13 || *end) {
+        fprintf(stderr, "znc: invalid error limit: %s\n", argv[i] + 13);
+        return 1;
+      }
+    }
+    else if (strncmp(argv[i], "--", 2) == 0) {
+      fprintf(stderr, "znc: unknown option: %s\n", argv[i]);
+      return 1;
+    }
+    else
+      path = argv[i];
+  }
+
+  if (!path) {
     fprintf(stderr, "znc: too few arguments\n");
     return 1;
   }
 
-  // read the file
-  char *text = util_readfile(argv[1]);
-  if (!text) {
-    fprintf(stderr, "znc: failed to read file: %s\n", argv[1]);
+  // read the file, "-" is stdin
+  SrcFile file;
+  if (util_loadfile(&file, path)) {
+    fprintf(stderr, "znc: failed to read file: %s\n", path);
     return 1;
   }
 
   // init lexer
   Lexer lex;
-  if (lexer_init(&lex, argv[1], text)) {
+  if (lexer_init(&lex, strcmp(path, "-") == 0 ? "<stdin>" : path, file.text)) {
     fprintf(stderr, "znc: failed to init lexer\n");
+    util_unloadfile(&file);
+    return 1;
+  }
+
+  lex.maxdepth = maxdepth;
+  lex.maxerrs = maxerrs;
+
+  // keep a bounded token window instead of the whole file
+  if (stream && lexer_setwindow(&lex, LEXER_MINWINDOW)) {
+    fprintf(stderr, "znc: failed to init lexer\n");
+    lexer_free(&lex);
+    util_unloadfile(&file);
+    return 1;
+  }
+
+  // lex on another thread while parsing
+  if (pipeline && lexer_pipeline(&lex)) {
+    fprintf(stderr, "znc: failed to init lexer\n");
+    lexer_free(&lex);
+    util_unloadfile(&file);
+    return 1;
+  }
+
+  // tokenize everything up front, unless tokens are made on demand
+  if (!stream && !lazy && !pipeline &&
+      (parallel ? lexer_tokenize_par(&lex, 0) : lexer_tokenize_all(&lex))) {
+    fprintf(stderr, "znc: failed to init lexer\n");
+    lexer_free(&lex);
+    util_unloadfile(&file);
     return 1;
   }
 
   // init arena
-  Arena *arena = arena_init(ARENA_MINSIZE);
+  Arena *arena = vmarena ? arena_initvm(0, hugepages) : arena_init(ARENA_MINSIZE);
   if (!arena) {
     fprintf(stderr, "znc: failed to init arena\n");
     lexer_free(&lex);
+    util_unloadfile(&file);
     return 1;
   }
 
   // parse node
   ASTRoot *node = parse(&lex, arena);
-  if (!node)
+  if (!node && lex.nerrs > 1)
+    fprintf(stderr, "znc: aborting due to %lu errors\n", (unsigned long)lex.nerrs);
+  else if (!node)
     fprintf(stderr, "znc: aborting due to error\n");
 
+  // where the memory went
+  if (memstats)
+    memstat_print(stderr, arena, memjson);
+
   arena_free(arena);
   lexer_free(&lex);
+  util_unloadfile(&file);
   return 1;
 }
-
@@ -0,0 +1,73 @@
+#include "memstat.h"
+#include "arena.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+MemStats MemStat = { 0 };
+
+void memstat_max(uvar *field, uvar val) {
+  uvar curr = __atomic_load_n(field, __ATOMIC_RELAXED);
+  while (curr < val &&
+         !__atomic_compare_exchange_n(field, &curr, val, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+// print for humans
+static void memstat_text(FILE *out, ArenaStats *st) {
+  fprintf(out, "memory:\n");
+  if (st) {
+    fprintf(out, "  arena:\n");
+    fprintf(out, "    requested:  %lu bytes in %lu allocations\n",
+        (unsigned long)st->requested, (unsigned long)st->allocs);
+    fprintf(out, "    used:       %lu bytes\n", (unsigned long)st->used);
+    fprintf(out, "    wasted:     %lu bytes at block tails\n", (unsigned long)st->wasted);
+    fprintf(out, "    blocks:     %lu\n", (unsigned long)st->blocks);
+    fprintf(out, "    footprint:  %lu bytes (peak %lu)\n",
+        (unsigned long)st->footprint, (unsigned long)st->peak);
+    for (int k = 0; k < AK_COUNT; k++) {
+      if (st->kcnt[k] == 0)
+        continue;
+      fprintf(out, "    %-13s %lu allocations, %lu bytes\n", ArenaKindNames[k],
+          (unsigned long)st->kcnt[k], (unsigned long)st->kbytes[k]);
+    }
+  }
+  fprintf(out, "  tokens:       %lu bytes (%lu reallocations)\n",
+      (unsigned long)MemStat.tokbytes, (unsigned long)MemStat.tokgrows);
+  fprintf(out, "  type sigs:    %lu bytes in %lu allocations\n",
+      (unsigned long)MemStat.sigbytes, (unsigned long)MemStat.sigs);
+}
+
+// print as a single json object
+static void memstat_json(FILE *out, ArenaStats *st) {
+  fprintf(out, "{");
+  if (st) {
+    fprintf(out, "\"arena\":{\"requested\":%lu,\"allocs\":%lu,\"used\":%lu,"
+        "\"wasted\":%lu,\"blocks\":%lu,\"footprint\":%lu,\"peak\":%lu,\"kinds\":{",
+        (unsigned long)st->requested, (unsigned long)st->allocs,
+        (unsigned long)st->used, (unsigned long)st->wasted,
+        (unsigned long)st->blocks, (unsigned long)st->footprint,
+        (unsigned long)st->peak);
+    for (int k = 0; k < AK_COUNT; k++)
+      fprintf(out, "%s\"%s\":{\"allocs\":%lu,\"bytes\":%lu}", k ? "," : "",
+          ArenaKindNames[k], (unsigned long)st->kcnt[k], (unsigned long)st->kbytes[k]);
+    fprintf(out, "}},");
+  }
+  fprintf(out, "\"tokens\":{\"bytes\":%lu,\"reallocs\":%lu},",
+      (unsigned long)MemStat.tokbytes, (unsigned long)MemStat.tokgrows);
+  fprintf(out, "\"typesigs\":{\"allocs\":%lu,\"bytes\":%lu}}\n",
+      (unsigned long)MemStat.sigs, (unsigned long)MemStat.sigbytes);
+}
+
+void memstat_print(FILE *out, Arena *arena, bool json) {
+  if (!out)
+    return;
+  ArenaStats st;
+  if (arena)
+    arena_stats(arena, &st);
+  if (json)
+    memstat_json(out, arena ? &st : NULL);
+  else
+    memstat_text(out, arena ? &st : NULL);
+}
@@ -0,0 +1,32 @@
+#ifndef _ZNC_MEMSTAT_H
+#define _ZNC_MEMSTAT_H
+#include "types.h"
+#include "arena.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+// memory counters of the allocations that do not go through an arena.
+// they are bumped from the lexer threads too, so only touch them with
+// the macros below
+
+typedef struct {
+  uvar sigs;            /* TypeSig and TypeFuncArg allocations */
+  uvar sigbytes;        /* bytes of them */
+  uvar tokgrows;        /* reallocations of token arrays */
+  uvar tokbytes;        /* bytes of the largest token array */
+} MemStats;
+
+extern MemStats MemStat;
+
+// add to a counter
+#define memstat_add(field, n) \
+  ((void)__atomic_fetch_add(&MemStat.field, (uvar)(n), __ATOMIC_RELAXED))
+
+/* raise a counter to val if it is lower */
+void memstat_max(uvar *field, uvar val);
+
+/* print the counters and the ones of an arena (may be NULL), as json or
+   for humans */
+void memstat_print(FILE *out, Arena *arena, bool json);
+
+#endif // _ZNC_MEMSTAT_H
@@ -0,0 +1,470 @@
+#include "number.h"
+#include "types.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// layout of a double
+#define F64_MANTBITS 52
+#define F64_MINEXP   (-1023)
+#define F64_INFEXP   0x7FF
+
+static double f64_frombits(uint64_t bits) {
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+// the decimal digits of a literal, as w * 10^q. only the first 19
+// significant digits fit in w, trunc tells if more were dropped
+typedef struct {
+  uint64_t w;
+  int64_t q;
+  bool trunc;
+} Decimal;
+
+static void num_decimal(const char *text, uvar len, Decimal *dec) {
+  const char *end = text + len;
+  uint64_t w = 0;
+  int64_t q = 0;
+  int digits = 0;
+  bool frac = false;
+  dec->trunc = false;
+
+  for (const char *p = text; p < end; p++) {
+    if (*p == '.') {
+      frac = true;
+      continue;
+    }
+    // leading zeros are not significant
+    if (digits == 0 && *p == '0') {
+      if (frac) q--;
+      continue;
+    }
+    if (digits < 19) {
+      w = w * 10 + (uint64_t)(*p - '0');
+      digits++;
+      if (frac) q--;
+    } else {
+      // dropped digits still scale the integer part
+      if (!frac) q++;
+      if (*p != '0') dec->trunc = true;
+    }
+  }
+
+  dec->w = w;
+  dec->q = q;
+}
+
+// clinger's fast path, w and 10^-q are exact doubles so one division
+// rounds correctly
+static const double NumPow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static bool num_clinger(Decimal *dec, double *out) {
+  if (dec->trunc || dec->w > ((uint64_t)1 << 53) || dec->q < -22 || dec->q > 22)
+    return false;
+  if (dec->q < 0)
+    *out = (double)dec->w / NumPow10[-dec->q];
+  else
+    *out = (double)dec->w * NumPow10[dec->q];
+  return true;
+}
+
+// 64x64 -> 128-bit multiply
+static void num_mul128(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+  __extension__ unsigned __int128 r = (unsigned __int128)a * b;
+  *hi = (uint64_t)(r >> 64);
+  *lo = (uint64_t)r;
+#else
+  uint64_t al = a & 0xFFFFFFFF, ah = a >> 32;
+  uint64_t bl = b & 0xFFFFFFFF, bh = b >> 32;
+  uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+  uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+  *lo = (mid << 32) | (ll & 0xFFFFFFFF);
+  *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// eisel-lemire, w * 10^q rounded to the bits of a double. w must be
+// exact (not truncated) and non-zero
+static uint64_t num_lemire(uint64_t w, int64_t q) {
+  if (q < NUM_POW5MIN)
+    return 0;
+  if (q > NUM_POW5MAX)
+    return (uint64_t)F64_INFEXP << F64_MANTBITS;
+
+  // normalize w, then take enough of w * 5^q to decide the rounding
+  int lz = __builtin_clzll(w);
+  w <<= lz;
+  const uint64_t *pow5 = NumPow5[q - NUM_POW5MIN];
+  uint64_t hi, lo;
+  num_mul128(w, pow5[0], &hi, &lo);
+  const uint64_t mask = UINT64_MAX >> (F64_MANTBITS + 3);
+  if ((hi & mask) == mask) {
+    uint64_t hi2, lo2;
+    num_mul128(w, pow5[1], &hi2, &lo2);
+    lo += hi2;
+    if (hi2 > lo) hi++;
+  }
+
+  // 2^q is folded into the exponent, floor(log2(10^q)) plus 63
+  int upper = (int)(hi >> 63);
+  uint64_t mant = hi >> (upper + 64 - F64_MANTBITS - 3);
+  int64_t exp = (((152170 + 65536) * q) >> 16) + 63 + upper - lz - F64_MINEXP;
+
+  // subnormal
+  if (exp <= 0) {
+    if (-exp + 1 >= 64)
+      return 0;
+    mant >>= -exp + 1;
+    mant += mant & 1;
+    mant >>= 1;
+    exp = mant < ((uint64_t)1 << F64_MANTBITS) ? 0 : 1;
+    return (mant & (((uint64_t)1 << F64_MANTBITS) - 1)) | ((uint64_t)exp << F64_MANTBITS);
+  }
+
+  // exactly halfway, only possible for small q, round to even
+  if (lo <= 1 && q >= -4 && q <= 23 && (mant & 3) == 1 &&
+      (mant << (upper + 64 - F64_MANTBITS - 3)) == hi)
+    mant &= ~(uint64_t)1;
+
+  mant += mant & 1;
+  mant >>= 1;
+  if (mant >= ((uint64_t)2 << F64_MANTBITS)) {
+    mant = (uint64_t)1 << F64_MANTBITS;
+    exp++;
+  }
+  mant &= ~((uint64_t)1 << F64_MANTBITS);
+  if (exp >= F64_INFEXP)
+    return (uint64_t)F64_INFEXP << F64_MANTBITS;
+  return mant | ((uint64_t)exp << F64_MANTBITS);
+}
+
+// slow path, an exact decimal shifted by powers of two until it holds
+// the mantissa (the simple decimal algorithm of go's strconv)
+typedef struct {
+  uint8_t d[NUM_MAXDIGITS + 24];  /* digits, most significant first */
+  int nd;                         /* number of digits */
+  int dp;                         /* position of the decimal point */
+  bool trunc;                     /* whether non-zero digits were dropped */
+} BigDecimal;
+
+// largest shift that does not overflow the accumulators
+#define NUM_MAXSHIFT 60
+
+static void big_trim(BigDecimal *a) {
+  while (a->nd > 0 && a->d[a->nd - 1] == 0)
+    a->nd--;
+  if (a->nd == 0)
+    a->dp = 0;
+}
+
+static void big_init(BigDecimal *a, const char *text, uvar len) {
+  a->nd = 0;
+  a->dp = 0;
+  a->trunc = false;
+  bool frac = false;
+  for (uvar i = 0; i < len; i++) {
+    if (text[i] == '.') {
+      frac = true;
+      continue;
+    }
+    if (a->nd == 0 && text[i] == '0') {
+      if (frac) a->dp--;
+      continue;
+    }
+    if (!frac) a->dp++;
+    if (a->nd < NUM_MAXDIGITS)
+      a->d[a->nd++] = text[i] - '0';
+    else if (text[i] != '0')
+      a->trunc = true;
+  }
+  big_trim(a);
+}
+
+// a /= 2^k
+static void big_rshift(BigDecimal *a, int k) {
+  int r = 0, w = 0;
+  uint64_t n = 0;
+  for (; (n >> k) == 0; r++) {
+    if (r >= a->nd) {
+      if (n == 0) {
+        a->nd = 0;
+        return;
+      }
+      while ((n >> k) == 0) {
+        n *= 10;
+        r++;
+      }
+      break;
+    }
+    n = n * 10 + a->d[r];
+  }
+  a->dp -= r - 1;
+
+  uint64_t mask = ((uint64_t)1 << k) - 1;
+  for (; r < a->nd; r++) {
+    a->d[w++] = (uint8_t)(n >> k);
+    n = (n & mask) * 10 + a->d[r];
+  }
+  while (n > 0) {
+    uint8_t dig = (uint8_t)(n >> k);
+    if (w < NUM_MAXDIGITS)
+      a->d[w++] = dig;
+    else if (dig > 0)
+      a->trunc = true;
+    n = (n & mask) * 10;
+  }
+  a->nd = w;
+  big_trim(a);
+}
+
+// a *= 2^k
+static void big_lshift(BigDecimal *a, int k) {
+  // at most this many new digits, the spare room of d holds them
+  int delta = (k * 1233 >> 12) + 1;
+  int r = a->nd, w = a->nd + delta;
+  uint64_t n = 0;
+  while (--r >= 0) {
+    n += (uint64_t)a->d[r] << k;
+    a->d[--w] = (uint8_t)(n % 10);
+    n /= 10;
+  }
+  while (n > 0) {
+    a->d[--w] = (uint8_t)(n % 10);
+    n /= 10;
+  }
+
+  // drop the unused room in front
+  a->nd += delta - w;
+  a->dp += delta - w;
+  memmove(a->d, a->d + w, a->nd);
+  if (a->nd > NUM_MAXDIGITS) {
+    for (int i = NUM_MAXDIGITS; i < a->nd; i++)
+      if (a->d[i]) a->trunc = true;
+    a->nd = NUM_MAXDIGITS;
+  }
+  big_trim(a);
+}
+
+static void big_shift(BigDecimal *a, int k) {
+  if (a->nd == 0)
+    return;
+  for (; k > NUM_MAXSHIFT; k -= NUM_MAXSHIFT)
+    big_lshift(a, NUM_MAXSHIFT);
+  for (; k < -NUM_MAXSHIFT; k += NUM_MAXSHIFT)
+    big_rshift(a, NUM_MAXSHIFT);
+  if (k > 0)
+    big_lshift(a, k);
+  else if (k < 0)
+    big_rshift(a, -k);
+}
+
+// whether the integer part must round up, ties to even
+static bool big_roundup(BigDecimal *a, int nd) {
+  if (nd < 0 || nd >= a->nd)
+    return false;
+  if (a->d[nd] == 5 && nd + 1 == a->nd) {
+    if (a->trunc)
+      return true;
+    return nd > 0 && (a->d[nd - 1] & 1);
+  }
+  return a->d[nd] >= 5;
+}
+
+static uint64_t big_integer(BigDecimal *a) {
+  uint64_t n = 0;
+  int i = 0;
+  for (; i < a->dp && i < a->nd; i++)
+    n = n * 10 + a->d[i];
+  for (; i < a->dp; i++)
+    n *= 10;
+  return n + big_roundup(a, a->dp);
+}
+
+static uint64_t num_slow(const char *text, uvar len) {
+  // shifts that bring dp down by about that many decimal places
+  static const int powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+  const int npow = sizeof(powtab) / sizeof(powtab[0]);
+
+  BigDecimal a;
+  big_init(&a, text, len);
+  if (a.nd == 0 || a.dp < -330)
+    return 0;
+  if (a.dp > 310)
+    return (uint64_t)F64_INFEXP << F64_MANTBITS;
+
+  // scale into [0.5, 1)
+  int exp = 0;
+  while (a.dp > 0) {
+    int n = a.dp >= npow ? 27 : powtab[a.dp];
+    big_shift(&a, -n);
+    exp += n;
+  }
+  while (a.dp < 0 || (a.dp == 0 && a.d[0] < 5)) {
+    int n = -a.dp >= npow ? 27 : powtab[-a.dp];
+    big_shift(&a, n);
+    exp -= n;
+  }
+
+  // [1, 2) from here, subnormals keep the smallest exponent
+  exp--;
+  if (exp < F64_MINEXP + 1) {
+    int n = F64_MINEXP + 1 - exp;
+    big_shift(&a, -n);
+    exp += n;
+  }
+  if (exp - F64_MINEXP >= F64_INFEXP)
+    return (uint64_t)F64_INFEXP << F64_MANTBITS;
+
+  big_shift(&a, 1 + F64_MANTBITS);
+  uint64_t mant = big_integer(&a);
+  if (mant == ((uint64_t)2 << F64_MANTBITS)) {
+    mant >>= 1;
+    exp++;
+    if (exp - F64_MINEXP >= F64_INFEXP)
+      return (uint64_t)F64_INFEXP << F64_MANTBITS;
+  }
+  if (!(mant & ((uint64_t)1 << F64_MANTBITS)))
+    exp = F64_MINEXP;
+  return (mant & (((uint64_t)1 << F64_MANTBITS) - 1)) |
+    ((uint64_t)(exp - F64_MINEXP) << F64_MANTBITS);
+}
+
+double num_float(const char *text, uvar len) {
+  Decimal dec;
+  num_decimal(text, len, &dec);
+  if (dec.w == 0)
+    return 0.0;
+
+  double out;
+  if (num_clinger(&dec, &out))
+    return out;
+
+  // dropped digits put the value between w and w + 1, if both round
+  // the same way that is the answer
+  uint64_t bits = num_lemire(dec.w, dec.q);
+  if (!dec.trunc || (dec.w + 1 != 0 && num_lemire(dec.w + 1, dec.q) == bits))
+    return f64_frombits(bits);
+
+  return f64_frombits(num_slow(text, len));
+}
+
+// integer literals
+
+static int num_radix(IntKind kind) {
+  switch (kind) {
+    case INTL_HEX: return 16;
+    case INTL_BIN: return 2;
+    case INTL_OCT: return 8;
+    default:       return 10;
+  }
+}
+
+// skip the radix prefix, 0x 0b 0o or the 0 of legacy octals
+static const char *num_digits(const char *text, uvar *len, IntKind kind) {
+  uvar skip = 0;
+  if (kind == INTL_HEX || kind == INTL_BIN)
+    skip = 2;
+  else if (kind == INTL_OCT)
+    skip = text[1] == 'o' ? 2 : 1;
+  *len -= skip;
+  return text + skip;
+}
+
+static int num_digitval(char ch) {
+  if (ch >= '0' && ch <= '9')
+    return ch - '0';
+  return (ch | 0x20) - 'a' + 10;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define NUM_SWAR
+#endif
+
+#ifdef NUM_SWAR
+// whether all 8 chars in v are decimal digits
+static bool num_isdigits8(uint64_t v) {
+  return ((v & UINT64_C(0xF0F0F0F0F0F0F0F0)) == UINT64_C(0x3030303030303030)) &&
+    (((v + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) ==
+     UINT64_C(0x3030303030303030));
+}
+
+// value of the 8 decimal digits in v, the first char in the low byte
+static uint64_t num_digits8(uint64_t v) {
+  const uint64_t mask = UINT64_C(0x000000FF000000FF);
+  const uint64_t mul1 = UINT64_C(100) + (UINT64_C(1000000) << 32);
+  const uint64_t mul2 = UINT64_C(1) + (UINT64_C(10000) << 32);
+  v -= UINT64_C(0x3030303030303030);
+  v = (v * 10) + (v >> 8);
+  return (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+}
+#endif // NUM_SWAR
+
+int num_int(const char *text, uvar len, IntKind kind, uint64_t *val) {
+  text = num_digits(text, &len, kind);
+  const char *end = text + len;
+  uint64_t radix = num_radix(kind);
+  uint64_t n = 0;
+
+  for (const char *p = text; p < end;) {
+#ifdef NUM_SWAR
+    // eight decimal digits at once, in the usual runs between separators
+    if (radix == 10 && end - p >= 8) {
+      uint64_t v;
+      memcpy(&v, p, sizeof(v));
+      if (num_isdigits8(v)) {
+        uint64_t d = num_digits8(v);
+        if (n > (UINT64_MAX - d) / 100000000)
+          return 1;
+        n = n * 100000000 + d;
+        p += 8;
+        continue;
+      }
+    }
+#endif // NUM_SWAR
+    if (*p == '_') {
+      p++;
+      continue;
+    }
+    uint64_t d = num_digitval(*p++);
+    if (n > (UINT64_MAX - d) / radix)
+      return 1;
+    n = n * radix + d;
+  }
+
+  *val = n;
+  return 0;
+}
+
+uvar num_intlimbs(uvar len, IntKind kind) {
+  // bits per digit, rounded up (4 for decimals)
+  uvar bits = kind == INTL_BIN ? 1 : kind == INTL_OCT ? 3 : 4;
+  return len * bits / 32 + 1;
+}
+
+uvar num_intbig(const char *text, uvar len, IntKind kind, uint32_t *limbs) {
+  uvar cap = num_intlimbs(len, kind);
+  text = num_digits(text, &len, kind);
+  uint64_t radix = num_radix(kind);
+  uvar cnt = 0;
+
+  for (uvar i = 0; i < len; i++) {
+    if (text[i] == '_')
+      continue;
+    // limbs = limbs * radix + digit
+    uint64_t carry = num_digitval(text[i]);
+    for (uvar j = 0; j < cnt; j++) {
+      uint64_t t = (uint64_t)limbs[j] * radix + carry;
+      limbs[j] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    if (carry && cnt < cap)
+      limbs[cnt++] = (uint32_t)carry;
+  }
+  return cnt;
+}
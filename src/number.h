@@ -0,0 +1,34 @@
+#ifndef _ZNC_NUMBER_H
+#define _ZNC_NUMBER_H
+#include "types.h"
+#include "token.h"
+#include <stdint.h>
+
+// conversion of numeric literals to their binary values
+
+// range of the power of five table
+#define NUM_POW5MIN (-342)
+#define NUM_POW5MAX 308
+
+// significant digits kept by the slow path, enough to round any double
+#define NUM_MAXDIGITS 800
+
+/* 128-bit powers of five, see pow5.c */
+extern const uint64_t NumPow5[][2];
+
+/* convert a float literal ([0-9]*.[0-9]*) to the nearest double, ties
+   to even */
+double num_float(const char *text, uvar len);
+
+/* decode an integer literal of the given kind into val, '_' separators
+   are skipped. returns 0 if it fits in 64 bits */
+int num_int(const char *text, uvar len, IntKind kind, uint64_t *val);
+
+/* number of 32-bit limbs that can hold an integer literal of len chars */
+uvar num_intlimbs(uvar len, IntKind kind);
+
+/* decode an integer literal into little-endian 32-bit limbs, returns the
+   number of limbs used, with no zero limbs on top */
+uvar num_intbig(const char *text, uvar len, IntKind kind, uint32_t *limbs);
+
+#endif // _ZNC_NUMBER_H
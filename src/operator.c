@@ -1,5 +1,5 @@
 #include "operator.h"
-#include <string.h>
+#include <stddef.h>
 
 const char *OperatorNames[] = {
   // ordered from longest string to shortest
@@ -18,92 +18,135 @@ const char *OperatorNames[] = {
   ",", "=", "<", ">", ".",
 };
 
-uvar isop(char *text) {
-  for (int i = 1; i < sizeof(OperatorNames) / sizeof(char*); i++) {
-    uvar len = strlen(OperatorNames[i]);
-    if (strncmp(text, OperatorNames[i], len) == 0)
-      return len;
-  }
-  return 0;
-}
+// operators grouped by their first char: the char alone, doubled, followed
+// by '=', doubled then followed by '=', and tripled
+typedef struct {
+  OperatorType one, dbl, eql, dbleql, trp;
+} OpEntry;
+
+static const OpEntry OperatorTable[128] = {
+  ['.'] = { OP_DOT, OP_UNK,     OP_UNK,     OP_UNK,         OP_TRP_DOT },
+  ['&'] = { OP_AMP, OP_DBL_AMP, OP_AMP_EQL, OP_DBL_AMP_EQL, OP_UNK },
+  ['|'] = { OP_BAR, OP_DBL_BAR, OP_BAR_EQL, OP_DBL_BAR_EQL, OP_UNK },
+  ['<'] = { OP_LES, OP_DBL_LES, OP_LES_EQL, OP_DBL_LES_EQL, OP_UNK },
+  ['>'] = { OP_GRT, OP_DBL_GRT, OP_GRT_EQL, OP_DBL_GRT_EQL, OP_UNK },
+  ['+'] = { OP_PLS, OP_DBL_PLS, OP_PLS_EQL, OP_UNK,         OP_UNK },
+  ['-'] = { OP_DSH, OP_DBL_DSH, OP_DSH_EQL, OP_UNK,         OP_UNK },
+  ['*'] = { OP_AST, OP_DBL_AST, OP_AST_EQL, OP_UNK,         OP_UNK },
+  ['='] = { OP_EQL, OP_DBL_EQL, OP_UNK,     OP_UNK,         OP_UNK },
+  ['!'] = { OP_EXC, OP_UNK,     OP_EXC_EQL, OP_UNK,         OP_UNK },
+  ['/'] = { OP_SLH, OP_UNK,     OP_SLH_EQL, OP_UNK,         OP_UNK },
+  ['%'] = { OP_PCT, OP_UNK,     OP_PCT_EQL, OP_UNK,         OP_UNK },
+  ['^'] = { OP_CRT, OP_UNK,     OP_CRT_EQL, OP_UNK,         OP_UNK },
+  ['~'] = { OP_TDL, OP_UNK,     OP_UNK,     OP_UNK,         OP_UNK },
+  ['?'] = { OP_QST, OP_UNK,     OP_UNK,     OP_UNK,         OP_UNK },
+  [':'] = { OP_CLN, OP_UNK,     OP_UNK,     OP_UNK,         OP_UNK },
+  [','] = { OP_CMM, OP_UNK,     OP_UNK,     OP_UNK,         OP_UNK },
+};
 
-OperatorType getop(char *text) {
-  for (int i = 1; i < sizeof(OperatorNames) / sizeof(char*); i++) {
-    if (strncmp(text, OperatorNames[i], strlen(OperatorNames[i])) == 0)
-      return i;
+uvar scanop(char *text, OperatorType *type) {
+  OperatorType op = OP_UNK;
+  uvar len = 0;
+  unsigned char ch = text ? (unsigned char)text[0] : 0;
+
+  // not an operator char at all
+  if (ch >= 128 || OperatorTable[ch].one == OP_UNK)
+    goto done;
+  const OpEntry *ent = &OperatorTable[ch];
+
+  // longest match first
+  if (text[1] == ch && text[2] == ch && ent->trp) {
+    op = ent->trp; len = 3;
+  } else if (text[1] == ch && text[2] == '=' && ent->dbleql) {
+    op = ent->dbleql; len = 3;
+  } else if (text[1] == ch && ent->dbl) {
+    op = ent->dbl; len = 2;
+  } else if (text[1] == '=' && ent->eql) {
+    op = ent->eql; len = 2;
+  } else {
+    op = ent->one; len = 1;
   }
-  return OP_UNK;
-}
 
-int getprec(OperatorType type) {
-  switch (type) {
-    // comma
-    case OP_CMM:
-      return 1;
+done:
+  if (type) *type = op;
+  return len;
+}
 
-    // assignment
-    case OP_EQL:
-    case OP_DBL_AMP_EQL:
-    case OP_DBL_BAR_EQL:
-    case OP_DBL_LES_EQL:
-    case OP_DBL_GRT_EQL:
-    case OP_PLS_EQL:
-    case OP_DSH_EQL:
-    case OP_AST_EQL:
-    case OP_SLH_EQL:
-    case OP_PCT_EQL:
-    case OP_AMP_EQL:
-    case OP_BAR_EQL:
-    case OP_CRT_EQL:
-      return 2;
-
-    // logical OR
-    case OP_DBL_BAR:
-      return 3;
-
-    // logical AND
-    case OP_DBL_AMP:
-      return 4;
-
-    // comparison
-    case OP_DBL_EQL:
-    case OP_EXC_EQL:
-    case OP_GRT:
-    case OP_GRT_EQL:
-    case OP_LES:
-    case OP_LES_EQL:
-      return 5;
-
-    // bitwise AND, OR, and XOR
-    case OP_AMP:
-    case OP_BAR:
-    case OP_CRT:
-      return 6;
-
-    // bitwise SHIFT LEFT and SHIFT RIGHT
-    case OP_DBL_LES:
-    case OP_DBL_GRT:
-      return 7;
-
-    // arithmetic ADD and SUBTRACT
-    case OP_PLS:
-    case OP_DSH:
-      return 8;
+uvar isop(char *text) {
+  return scanop(text, NULL);
+}
 
-    // arithmetic MULTIPLY, DIVIDE, and MODULO
-    case OP_AST:
-    case OP_SLH:
-    case OP_PCT:
-      return 9;
+OperatorType getop(char *text) {
+  OperatorType op;
+  scanop(text, &op);
+  return op;
+}
 
-    // arithmetic EXPONENT
-    case OP_DBL_AST:
-      return 10;
+// binding powers of the binary operators, the lbp is the precedence of
+// the operator and the rbp is the lowest precedence the right operand may
+// take. left-associative operators use lbp + 1, so a following operator of
+// the same precedence ends the operand, right-associative ones use lbp
+#define BIND_LEFT(prec)  { prec, prec + 1 }
+#define BIND_RIGHT(prec) { prec, prec }
+
+const OpBind OpBindTable[OP_SBC + 1] = {
+  // comma
+  [OP_CMM]         = BIND_LEFT(1),
+
+  // assignment
+  [OP_EQL]         = BIND_RIGHT(2),
+  [OP_DBL_AMP_EQL] = BIND_RIGHT(2),
+  [OP_DBL_BAR_EQL] = BIND_RIGHT(2),
+  [OP_DBL_LES_EQL] = BIND_RIGHT(2),
+  [OP_DBL_GRT_EQL] = BIND_RIGHT(2),
+  [OP_PLS_EQL]     = BIND_RIGHT(2),
+  [OP_DSH_EQL]     = BIND_RIGHT(2),
+  [OP_AST_EQL]     = BIND_RIGHT(2),
+  [OP_SLH_EQL]     = BIND_RIGHT(2),
+  [OP_PCT_EQL]     = BIND_RIGHT(2),
+  [OP_AMP_EQL]     = BIND_RIGHT(2),
+  [OP_BAR_EQL]     = BIND_RIGHT(2),
+  [OP_CRT_EQL]     = BIND_RIGHT(2),
+
+  // logical OR
+  [OP_DBL_BAR]     = BIND_LEFT(3),
+
+  // logical AND
+  [OP_DBL_AMP]     = BIND_LEFT(4),
+
+  // comparison
+  [OP_DBL_EQL]     = BIND_LEFT(5),
+  [OP_EXC_EQL]     = BIND_LEFT(5),
+  [OP_GRT]         = BIND_LEFT(5),
+  [OP_GRT_EQL]     = BIND_LEFT(5),
+  [OP_LES]         = BIND_LEFT(5),
+  [OP_LES_EQL]     = BIND_LEFT(5),
+
+  // bitwise AND, OR, and XOR
+  [OP_AMP]         = BIND_LEFT(6),
+  [OP_BAR]         = BIND_LEFT(6),
+  [OP_CRT]         = BIND_LEFT(6),
+
+  // bitwise SHIFT LEFT and SHIFT RIGHT
+  [OP_DBL_LES]     = BIND_LEFT(7),
+  [OP_DBL_GRT]     = BIND_LEFT(7),
+
+  // arithmetic ADD and SUBTRACT
+  [OP_PLS]         = BIND_LEFT(8),
+  [OP_DSH]         = BIND_LEFT(8),
+
+  // arithmetic MULTIPLY, DIVIDE, and MODULO
+  [OP_AST]         = BIND_LEFT(9),
+  [OP_SLH]         = BIND_LEFT(9),
+  [OP_PCT]         = BIND_LEFT(9),
+
+  // arithmetic EXPONENT
+  [OP_DBL_AST]     = BIND_RIGHT(10),
+};
 
-    // default case
-    default:
-      return 0;
-  }
+int getprec(OperatorType type) {
+  if (type > OP_SBC) return 0;
+  return OpBindTable[type].lbp;
 }
 
 int op_isprefix(OperatorType type) {
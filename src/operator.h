@@ -1,6 +1,7 @@
 #ifndef _ZNC_OPERATOR_H
 #define _ZNC_OPERATOR_H
 #include "types.h"
+#include <stdint.h>
 
 // this value should reflect the highest return
 // value of getprec() function. update this if
@@ -57,12 +58,26 @@ typedef enum {
 // operators
 extern const char *OperatorNames[];
 
+/* longest-match scan of the operator at text, returns its length and
+   stores its type into type (if not NULL), 0 and OP_UNK if none */
+uvar scanop(char *text, OperatorType *type);
+
 /* returns the length of operator, 0 if op does not exist */
 uvar isop(char *text);
 
 /* returns OperatorType from given string */
 OperatorType getop(char *text);
 
+// binding powers of a binary operator, lbp is zero for the operators
+// that are not binary
+typedef struct {
+  uint8_t lbp;    /* precedence of the operator */
+  uint8_t rbp;    /* lowest precedence allowed in the right operand */
+} OpBind;
+
+// binding powers indexed by OperatorType
+extern const OpBind OpBindTable[];
+
 /* get operator precedence of binary operators */
 int getprec(OperatorType type);
 
@@ -0,0 +1,185 @@
+// for pthreads and sysconf()
+#define _POSIX_C_SOURCE 200809L
+#include "parlex.h"
+#include "lexer.h"
+#include "types.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// tokens lexed between checks for the chunk end
+#define PARLEX_BATCH 256
+
+typedef struct {
+  Lexer lex;            /* private lexer over the shared input */
+  uvar start;           /* where lexing of the chunk starts */
+  uvar end;             /* tokens at or after end belong to the next chunk */
+  uvar cnt;             /* number of tokens before end */
+  bool done;            /* whether a token at or after end was reached */
+} Chunk;
+
+typedef struct {
+  Chunk *chunks;
+  uvar cnt;
+  uvar next;            /* next chunk to pick, shared by the workers */
+} Pool;
+
+// lex a chunk from pos until the first token at or after its end
+static void parlex_chunk(Chunk *ch, uvar pos) {
+  Lexer *lex = &ch->lex;
+  lex->lex  = lex->input + pos;
+  lex->eof  = false;
+  lex->tcnt = 0;
+
+  while (!lex->eof) {
+    lexer_scan(lex, PARLEX_BATCH);
+    if (lex->tcnt > 0 && lex->toks[lex->tcnt - 1].pos >= ch->end)
+      break;
+  }
+
+  // drop what was lexed past the end but the first token
+  uvar i = lex->tcnt;
+  while (i > 0 && lex->toks[i - 1].pos >= ch->end)
+    i--;
+  ch->cnt  = i;
+  ch->done = i < lex->tcnt;
+}
+
+static void *parlex_worker(void *arg) {
+  Pool *pool = (Pool*)arg;
+  for (;;) {
+    uvar idx = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+    if (idx >= pool->cnt)
+      break;
+    parlex_chunk(&pool->chunks[idx], pool->chunks[idx].start);
+  }
+  return NULL;
+}
+
+// cut the input after newlines, returns the number of chunks
+static uvar parlex_split(Lexer *lex, Chunk *chunks, uvar want) {
+  uvar cnt = 0;
+  uvar start = 0;
+  for (uvar i = 1; i < want; i++) {
+    uvar target = lex->len / want * i;
+    if (target < start)
+      continue;
+    char *nl = memchr(lex->input + target, '\n', lex->len - target);
+    if (!nl)
+      break;
+    chunks[cnt].start = start;
+    chunks[cnt].end   = nl + 1 - lex->input;
+    start = chunks[cnt++].end;
+  }
+  chunks[cnt].start = start;
+  chunks[cnt].end   = lex->len;
+  return cnt + 1;
+}
+
+// join the chunk tokens into lex, returns 0 if succeded
+static int parlex_stitch(Lexer *lex, Chunk *chunks, uvar cnt) {
+  // every chunk must start where the one before stopped, a chunk that
+  // did not (it began inside a block comment) is lexed again. the first
+  // chunk starts at the input, its first token can be anywhere
+  uvar resume = 0;
+  uvar total = 1;
+  Token *stop = NULL;
+  for (uvar i = 0; i < cnt; i++) {
+    Chunk *ch = &chunks[i];
+    if (resume >= ch->end) {
+      ch->cnt = 0;
+      continue;
+    }
+    if (!ch->done || (i > 0 && ch->lex.toks[0].pos != resume))
+      parlex_chunk(ch, resume);
+    // stopped early, a lexical error or out of memory
+    if (!ch->done)
+      return 1;
+    total += ch->cnt;
+    stop = &ch->lex.toks[ch->cnt];
+    resume = stop->pos;
+  }
+
+  // the last chunk stops at the eof token
+  if (!stop || stop->type != TOKEN_EOF)
+    return 1;
+
+  if (lexer_resize(lex, total))
+    return 1;
+  Token *toks = lex->toks;
+  lex->tcnt   = 0;
+  for (uvar i = 0; i < cnt; i++) {
+    memcpy(toks + lex->tcnt, chunks[i].lex.toks, sizeof(Token) * chunks[i].cnt);
+    lex->tcnt += chunks[i].cnt;
+  }
+  toks[lex->tcnt++] = *stop;
+  lex->lex = lex->input + lex->len;
+  lex->eof = true;
+  return 0;
+}
+
+int lexer_tokenize_par(Lexer *lex, uvar nthreads) {
+  if (!lex || lex->stream || lex->pipe || lex->tcnt > 0)
+    return 1;
+
+  if (nthreads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = cpus > 0 ? (uvar)cpus : 1;
+  }
+
+  // not worth the threads
+  uvar want = lex->len / PARLEX_MINCHUNK;
+  if (want > nthreads * PARLEX_SPLIT)
+    want = nthreads * PARLEX_SPLIT;
+  if (nthreads < 2 || want < 2)
+    return lexer_tokenize_all(lex);
+
+  Chunk *chunks = (Chunk*)calloc(want, sizeof(Chunk));
+  if (!chunks)
+    return 1;
+  uvar cnt = parlex_split(lex, chunks, want);
+
+  // private lexers share the input but not the token storage
+  uvar ready = 0;
+  for (; ready < cnt; ready++) {
+    Chunk *ch = &chunks[ready];
+    ch->lex = *lex;
+    ch->lex.quiet = true;
+    ch->lex.talloc = (ch->end - ch->start) / LEXER_BYTESPERTOK + 2;
+    ch->lex.toks = (Token*)malloc(sizeof(Token) * ch->lex.talloc);
+    if (!ch->lex.toks)
+      break;
+  }
+
+  int err = ready < cnt;
+  if (!err) {
+    Pool pool = { chunks, cnt, 0 };
+    if (nthreads > cnt)
+      nthreads = cnt;
+
+    // the calling thread works too, fewer threads are fine if some
+    // could not be started
+    pthread_t *threads = (pthread_t*)malloc(sizeof(pthread_t) * nthreads);
+    uvar started = 0;
+    while (threads && started < nthreads - 1 &&
+        pthread_create(&threads[started], NULL, parlex_worker, &pool) == 0)
+      started++;
+    parlex_worker(&pool);
+    for (uvar i = 0; i < started; i++)
+      pthread_join(threads[i], NULL);
+    free(threads);
+
+    err = parlex_stitch(lex, chunks, cnt);
+  }
+
+  for (uvar i = 0; i < ready; i++)
+    free(chunks[i].lex.toks);
+  free(chunks);
+
+  // errors are reported by the sequential lexer
+  if (err)
+    return lexer_tokenize_all(lex);
+  return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef _ZNC_PARLEX_H
+#define _ZNC_PARLEX_H
+#include "types.h"
+#include "lexer.h"
+
+// parallel lexing of big inputs. the input is cut after newlines and
+// every chunk is lexed on its own thread, then the token arrays are
+// stitched into the lexer. a cut inside a block comment is detected
+// while stitching and that chunk is lexed again from the right place
+
+// smallest chunk worth a thread
+#define PARLEX_MINCHUNK (1024 * 1024)
+
+// chunks per thread, more chunks balance the work better
+#define PARLEX_SPLIT 4
+
+/* tokenize the whole input on up to nthreads threads (0 for one per
+   online cpu). small inputs and inputs with lexical errors are lexed
+   sequentially. not available in streaming mode, returns 0 if succeded */
+int lexer_tokenize_par(Lexer *lex, uvar nthreads);
+
+#endif // _ZNC_PARLEX_H
@@ -0,0 +1,132 @@
+// for pthreads and sched_yield()
+#define _POSIX_C_SOURCE 200809L
+#include "pipeline.h"
+#include "lexer.h"
+#include "types.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+// busy polls before giving the cpu away while waiting
+#define PIPE_SPIN 64
+
+typedef struct {
+  Token toks[PIPE_BATCH];
+  uvar cnt;
+  bool last;            /* the lexer thread is done after this batch */
+} Batch;
+
+typedef struct LexPipe {
+  Lexer lex;            /* private lexer of the lexer thread */
+  pthread_t thread;
+  Batch slots[PIPE_SLOTS];
+  uvar head;            /* batches pushed, written by the lexer thread */
+  uvar tail;            /* batches taken, written by the parser side */
+  uvar next;            /* next token of the batch at tail */
+  bool stop;            /* asks the lexer thread to give up */
+} LexPipe;
+
+// wait a moment, spinning first then yielding
+static void pipe_wait(unsigned *spin) {
+  if (++*spin < PIPE_SPIN)
+    return;
+  *spin = 0;
+  sched_yield();
+}
+
+static void *pipe_worker(void *arg) {
+  LexPipe *pipe = (LexPipe*)arg;
+  Lexer *lex = &pipe->lex;
+  uvar head = 0;
+
+  while (!lex->eof && !__atomic_load_n(&pipe->stop, __ATOMIC_RELAXED)) {
+    // wait for a free slot
+    unsigned spin = 0;
+    while (head - __atomic_load_n(&pipe->tail, __ATOMIC_ACQUIRE) == PIPE_SLOTS) {
+      if (__atomic_load_n(&pipe->stop, __ATOMIC_RELAXED))
+        return NULL;
+      pipe_wait(&spin);
+    }
+
+    // lex right into the slot
+    Batch *b = &pipe->slots[head & (PIPE_SLOTS - 1)];
+    lex->toks = b->toks;
+    lex->tcnt = 0;
+    lexer_scan(lex, PIPE_BATCH);
+    b->cnt  = lex->tcnt;
+    b->last = lex->eof;
+
+    // publish it
+    __atomic_store_n(&pipe->head, ++head, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+int lexer_pipeline(Lexer *lex) {
+  if (!lex || lex->pipe || lex->tcnt > 0 || lex->eof)
+    return 1;
+
+  LexPipe *pipe = (LexPipe*)malloc(sizeof(LexPipe));
+  if (!pipe)
+    return 1;
+
+  // the thread lexes the same input quietly, diagnostics are printed
+  // when the parser side takes the error token
+  pipe->lex = *lex;
+  pipe->lex.quiet  = true;
+  pipe->lex.stream = false;
+  pipe->lex.talloc = PIPE_BATCH;
+  pipe->head = 0;
+  pipe->tail = 0;
+  pipe->next = 0;
+  pipe->stop = false;
+
+  if (pthread_create(&pipe->thread, NULL, pipe_worker, pipe) != 0) {
+    free(pipe);
+    return 1;
+  }
+  lex->pipe = pipe;
+  return 0;
+}
+
+void lexer_endpipeline(Lexer *lex) {
+  if (!lex || !lex->pipe)
+    return;
+  __atomic_store_n(&lex->pipe->stop, true, __ATOMIC_RELAXED);
+  pthread_join(lex->pipe->thread, NULL);
+  free(lex->pipe);
+  lex->pipe = NULL;
+}
+
+void lexer_pull(Lexer *lex) {
+  if (!lex || !lex->pipe || lex->eof)
+    return;
+  LexPipe *pipe = lex->pipe;
+
+  // wait for the next batch
+  uvar tail = pipe->tail;
+  unsigned spin = 0;
+  while (__atomic_load_n(&pipe->head, __ATOMIC_ACQUIRE) == tail)
+    pipe_wait(&spin);
+
+  // one token at a time, so diagnostics come out in the same order as
+  // with the lexer on this thread
+  Batch *b = &pipe->slots[tail & (PIPE_SLOTS - 1)];
+  if (pipe->next < b->cnt) {
+    Token *tok = &b->toks[pipe->next++];
+    lexer_emit(lex, tok);
+    lexer_report(lex, tok);
+  }
+  if (pipe->next < b->cnt)
+    return;
+
+  // used up, hand the slot back
+  bool last = b->last;
+  pipe->next = 0;
+  __atomic_store_n(&pipe->tail, tail + 1, __ATOMIC_RELEASE);
+  if (last) {
+    lex->lex = lex->input + lex->len;
+    lex->eof = true;
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef _ZNC_PIPELINE_H
+#define _ZNC_PIPELINE_H
+#include "types.h"
+#include "lexer.h"
+
+// pipelined lexing. a lexer thread fills batches of tokens in a
+// single-producer single-consumer ring, and lexer_tokenize() of the
+// parser side takes them out. the parser only waits when it needs a
+// token the lexer thread has not made yet
+
+// tokens per batch
+#define PIPE_BATCH 256
+
+// batches in the ring, a power of two
+#define PIPE_SLOTS 64
+
+/* start lexing on a thread. must be called before any token is
+   processed, returns 0 if succeded */
+int lexer_pipeline(Lexer *lex);
+
+/* stop and join the lexer thread, if any */
+void lexer_endpipeline(Lexer *lex);
+
+/* emit the next token from the lexer thread, waits for it if needed */
+void lexer_pull(Lexer *lex);
+
+#endif // _ZNC_PIPELINE_H
@@ -0,0 +1,218 @@
+#include "scan.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+typedef struct {
+  const char *name;
+  char *(*space)(char*);
+  char *(*line)(char*);
+  char *(*star)(char*);
+  char *(*strbody)(char*);
+  char *(*strrun)(char*);
+} ScanImpl;
+
+// scalar kernels, used where no vector kernel exists and as the reference
+// the vector ones are tested against
+
+static char *scalar_space(char *p) {
+  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+    p++;
+  return p;
+}
+
+static char *scalar_line(char *p) {
+  while (*p != '\n' && *p != '\0')
+    p++;
+  return p;
+}
+
+static char *scalar_star(char *p) {
+  while (*p != '*' && *p != '\0')
+    p++;
+  return p;
+}
+
+static char *scalar_strbody(char *p) {
+  while (*p != '"' && *p != '\\' && *p != '\n' && *p != '\r' && *p != '\0')
+    p++;
+  return p;
+}
+
+static char *scalar_strrun(char *p) {
+  while (*p != '"' && *p != '\\' && *p != '\0' && !(*p & 0x80))
+    p++;
+  return p;
+}
+
+static const ScanImpl ScanScalar = {
+  "scalar", scalar_space, scalar_line, scalar_star, scalar_strbody,
+  scalar_strrun,
+};
+
+#ifdef SCAN_X86
+
+// the vector kernels only do aligned loads, an aligned load never crosses
+// a page boundary, so reading the rest of the block that holds the
+// NUL-terminator is safe. bits of the bytes before the start are shifted
+// out of the first mask
+
+#define SCAN_KERNEL(name, attr, vec, W, load, MASK)                     \
+  attr SCAN_NOASAN static char *name(char *p) {                         \
+    uintptr_t off = (uintptr_t)p & (W - 1);                             \
+    const vec *blk = (const vec*)(p - off);                             \
+    vec v = load(blk);                                                  \
+    unsigned m = (unsigned)(MASK(v)) >> off;                            \
+    if (m) return p + __builtin_ctz(m);                                 \
+    for (;;) {                                                          \
+      v = load(++blk);                                                  \
+      m = (unsigned)(MASK(v));                                          \
+      if (m) return (char*)blk + __builtin_ctz(m);                      \
+    }                                                                   \
+  }
+
+// the tail read is intended, keep the address sanitizer away from it
+#define SCAN_NOASAN __attribute__((no_sanitize_address))
+
+// sse2, part of the x86-64 baseline
+
+#define SSE_EQ(v, c) _mm_cmpeq_epi8((v), _mm_set1_epi8(c))
+#define SSE_OR(a, b) _mm_or_si128((a), (b))
+#define SSE_MASK(v)  ((unsigned)_mm_movemask_epi8(v))
+
+#define SSE_SPACE(v) (~SSE_MASK(SSE_OR(SSE_OR(SSE_EQ(v, ' '), SSE_EQ(v, '\t')), \
+                      SSE_OR(SSE_EQ(v, '\n'), SSE_EQ(v, '\r')))) & 0xffffu)
+#define SSE_LINE(v)  SSE_MASK(SSE_OR(SSE_EQ(v, '\n'), SSE_EQ(v, '\0')))
+#define SSE_STAR(v)  SSE_MASK(SSE_OR(SSE_EQ(v, '*'), SSE_EQ(v, '\0')))
+#define SSE_STR(v)   SSE_MASK(SSE_OR(SSE_OR(SSE_EQ(v, '"'), SSE_EQ(v, '\\')), \
+                      SSE_OR(SSE_OR(SSE_EQ(v, '\n'), SSE_EQ(v, '\r')), SSE_EQ(v, '\0'))))
+#define SSE_RUN(v)   (SSE_MASK(v) | SSE_MASK(SSE_OR(SSE_OR(SSE_EQ(v, '"'), \
+                      SSE_EQ(v, '\\')), SSE_EQ(v, '\0'))))
+
+SCAN_KERNEL(sse2_space,   , __m128i, 16, _mm_load_si128, SSE_SPACE)
+SCAN_KERNEL(sse2_line,    , __m128i, 16, _mm_load_si128, SSE_LINE)
+SCAN_KERNEL(sse2_star,    , __m128i, 16, _mm_load_si128, SSE_STAR)
+SCAN_KERNEL(sse2_strbody, , __m128i, 16, _mm_load_si128, SSE_STR)
+SCAN_KERNEL(sse2_strrun,  , __m128i, 16, _mm_load_si128, SSE_RUN)
+
+static const ScanImpl ScanSSE2 = {
+  "sse2", sse2_space, sse2_line, sse2_star, sse2_strbody, sse2_strrun,
+};
+
+// avx2, only used when cpuid reports it
+
+#define AVX_ATTR     __attribute__((target("avx2")))
+#define AVX_EQ(v, c) _mm256_cmpeq_epi8((v), _mm256_set1_epi8(c))
+#define AVX_OR(a, b) _mm256_or_si256((a), (b))
+#define AVX_MASK(v)  ((unsigned)_mm256_movemask_epi8(v))
+
+#define AVX_SPACE(v) (~AVX_MASK(AVX_OR(AVX_OR(AVX_EQ(v, ' '), AVX_EQ(v, '\t')), \
+                      AVX_OR(AVX_EQ(v, '\n'), AVX_EQ(v, '\r')))))
+#define AVX_LINE(v)  AVX_MASK(AVX_OR(AVX_EQ(v, '\n'), AVX_EQ(v, '\0')))
+#define AVX_STAR(v)  AVX_MASK(AVX_OR(AVX_EQ(v, '*'), AVX_EQ(v, '\0')))
+#define AVX_STR(v)   AVX_MASK(AVX_OR(AVX_OR(AVX_EQ(v, '"'), AVX_EQ(v, '\\')), \
+                      AVX_OR(AVX_OR(AVX_EQ(v, '\n'), AVX_EQ(v, '\r')), AVX_EQ(v, '\0'))))
+#define AVX_RUN(v)   (AVX_MASK(v) | AVX_MASK(AVX_OR(AVX_OR(AVX_EQ(v, '"'), \
+                      AVX_EQ(v, '\\')), AVX_EQ(v, '\0'))))
+
+SCAN_KERNEL(avx2_space,   AVX_ATTR, __m256i, 32, _mm256_load_si256, AVX_SPACE)
+SCAN_KERNEL(avx2_line,    AVX_ATTR, __m256i, 32, _mm256_load_si256, AVX_LINE)
+SCAN_KERNEL(avx2_star,    AVX_ATTR, __m256i, 32, _mm256_load_si256, AVX_STAR)
+SCAN_KERNEL(avx2_strbody, AVX_ATTR, __m256i, 32, _mm256_load_si256, AVX_STR)
+SCAN_KERNEL(avx2_strrun,  AVX_ATTR, __m256i, 32, _mm256_load_si256, AVX_RUN)
+
+static const ScanImpl ScanAVX2 = {
+  "avx2", avx2_space, avx2_line, avx2_star, avx2_strbody, avx2_strrun,
+};
+
+#endif // SCAN_X86
+
+// whether the cpu can run a kernel
+static bool scan_supported(const ScanImpl *impl) {
+#ifdef SCAN_X86
+  if (impl == &ScanAVX2) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  (void)impl;
+  return true;
+}
+
+// every kernel, the preferred one first
+static const ScanImpl *const ScanKernels[] = {
+#ifdef SCAN_X86
+  &ScanAVX2,
+  &ScanSSE2,
+#endif
+  &ScanScalar,
+};
+
+#define SCAN_NKERNELS (sizeof(ScanKernels) / sizeof(ScanKernels[0]))
+
+// the kernel in use. it is picked on first use, the lexer threads may get
+// there at the same time but they all pick the same one
+static const ScanImpl *ScanCurrent = NULL;
+
+static const ScanImpl *scan_impl(void) {
+  const ScanImpl *impl = __atomic_load_n(&ScanCurrent, __ATOMIC_ACQUIRE);
+  if (impl) return impl;
+  for (uvar i = 0; i < SCAN_NKERNELS; i++) {
+    if (scan_supported(ScanKernels[i])) {
+      impl = ScanKernels[i];
+      break;
+    }
+  }
+  __atomic_store_n(&ScanCurrent, impl, __ATOMIC_RELEASE);
+  return impl;
+}
+
+char *scan_space(char *text) {
+  return scan_impl()->space(text);
+}
+
+char *scan_line(char *text) {
+  return scan_impl()->line(text);
+}
+
+char *scan_cmtend(char *text) {
+  const ScanImpl *impl = scan_impl();
+  for (;;) {
+    text = impl->star(text);
+    if (*text == '\0' || text[1] == '/')
+      return text;
+    text++;
+  }
+}
+
+char *scan_strbody(char *text) {
+  return scan_impl()->strbody(text);
+}
+
+char *scan_strrun(char *text) {
+  return scan_impl()->strrun(text);
+}
+
+const char *scan_kernel(void) {
+  return scan_impl()->name;
+}
+
+int scan_setkernel(const char *name) {
+  for (uvar i = 0; i < SCAN_NKERNELS; i++) {
+    const ScanImpl *impl = ScanKernels[i];
+    if (!name ? scan_supported(impl) : strcmp(impl->name, name) == 0) {
+      if (!scan_supported(impl))
+        return 1;
+      __atomic_store_n(&ScanCurrent, impl, __ATOMIC_RELEASE);
+      return 0;
+    }
+  }
+  return 1;
+}
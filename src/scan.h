@@ -0,0 +1,35 @@
+#ifndef _ZNC_SCAN_H
+#define _ZNC_SCAN_H
+#include "types.h"
+
+// bulk scanners used by the tokenizer to skip uninteresting runs of
+// bytes. all of them expect a NUL-terminated string and never go past
+// the terminator. the kernel (avx2, sse2 or scalar) is picked once at
+// runtime from what the cpu supports
+
+/* returns the first char that is not a whitespace */
+char *scan_space(char *text);
+
+/* returns the first '\n' or the NUL-terminator */
+char *scan_line(char *text);
+
+/* returns the start of the first block comment end '*' '/', or the
+   NUL-terminator */
+char *scan_cmtend(char *text);
+
+/* returns the first '"', '\\', '\r', '\n' or the NUL-terminator */
+char *scan_strbody(char *text);
+
+/* returns the first '"', '\\', non-ascii byte or the NUL-terminator */
+char *scan_strrun(char *text);
+
+/* name of the kernel in use */
+const char *scan_kernel(void);
+
+/* use the kernel of the given name ("avx2", "sse2" or "scalar"), or the
+   default one if name is NULL. should be called before any lexing
+   starts, returns 0 if succeded and 1 if the kernel is missing or the
+   cpu cannot run it */
+int scan_setkernel(const char *name);
+
+#endif // _ZNC_SCAN_H
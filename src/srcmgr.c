@@ -0,0 +1,139 @@
+#include "srcmgr.h"
+#include "types.h"
+#include <stdlib.h>
+#include <string.h>
+
+// registered buffers, sorted by base since ranges are handed out in
+// order. pointers to the buffers stay valid when the list grows. the
+// structs past SrcCnt are kept by src_reset() for reuse
+static SrcBuffer **SrcBufs = NULL;
+static uvar SrcCnt = 0;
+static uvar SrcMade = 0;
+static uvar SrcAlloc = 0;
+static uint64_t SrcNext = SRCLOC_NONE + 1;
+
+SrcBuffer *src_add(char *name, char *text, uvar len) {
+  if (SrcNext + len + 1 > (uint64_t)UINT32_MAX + 1)
+    return NULL;
+
+  if (SrcCnt == SrcAlloc) {
+    uvar alloc = SrcAlloc ? SrcAlloc * 2 : 8;
+    SrcBuffer **tmp = (SrcBuffer**)realloc(SrcBufs, sizeof(SrcBuffer*) * alloc);
+    if (!tmp)
+      return NULL;
+    SrcBufs = tmp;
+    SrcAlloc = alloc;
+  }
+
+  SrcBuffer *buf = SrcCnt < SrcMade ? SrcBufs[SrcCnt] : NULL;
+  if (!buf) {
+    buf = (SrcBuffer*)malloc(sizeof(SrcBuffer));
+    if (!buf)
+      return NULL;
+    SrcBufs[SrcMade++] = buf;
+  }
+  buf->name  = name;
+  buf->text  = text;
+  buf->len   = len;
+  buf->base  = (SrcLoc)SrcNext;
+  buf->lines = NULL;
+  buf->lcnt  = 0;
+
+  SrcCnt++;
+  SrcNext += len + 1;
+  return buf;
+}
+
+SrcBuffer *src_find(SrcLoc loc) {
+  if (loc == SRCLOC_NONE || SrcCnt == 0)
+    return NULL;
+
+  // the last buffer that starts at or before loc
+  uvar lo = 0, hi = SrcCnt;
+  while (hi - lo > 1) {
+    uvar mid = lo + (hi - lo) / 2;
+    if (SrcBufs[mid]->base <= loc) lo = mid;
+    else                           hi = mid;
+  }
+
+  SrcBuffer *buf = SrcBufs[lo];
+  if (loc < buf->base || loc - buf->base > buf->len)
+    return NULL;
+  return buf;
+}
+
+// build the table of line start offsets
+static int src_mklines(SrcBuffer *buf) {
+  char *end = buf->text + buf->len;
+
+  // count the lines first, so the table is allocated once
+  uvar cnt = 1;
+  for (char *nl = buf->text; (nl = memchr(nl, '\n', end - nl)) != NULL; nl++)
+    cnt++;
+
+  uvar *lines = (uvar*)malloc(sizeof(uvar) * cnt);
+  if (!lines)
+    return 1;
+
+  lines[0] = 0;
+  uvar i = 1;
+  for (char *nl = buf->text; (nl = memchr(nl, '\n', end - nl)) != NULL; nl++)
+    lines[i++] = nl + 1 - buf->text;
+
+  buf->lines = lines;
+  buf->lcnt  = cnt;
+  return 0;
+}
+
+int src_getloc(SrcLoc loc, SrcBuffer **bufp, uvar *line, uvar *col) {
+  SrcBuffer *buf = src_find(loc);
+  if (!buf)
+    return 1;
+  if (!buf->lines && src_mklines(buf))
+    return 1;
+  uvar pos = loc - buf->base;
+
+  // find the last line that starts at or before pos
+  uvar lo = 0, hi = buf->lcnt;
+  while (hi - lo > 1) {
+    uvar mid = lo + (hi - lo) / 2;
+    if (buf->lines[mid] <= pos) lo = mid;
+    else                        hi = mid;
+  }
+
+  // expand tabs up to pos, a carriage return restarts the column
+  uvar c = 1;
+  for (char *ch = buf->text + buf->lines[lo]; ch < buf->text + pos; ch++) {
+    if (*ch == '\r')
+      c = 1;
+    else if (*ch == '\t')
+      // +1 because col starts at 1
+      c += 8 - (c % 8) + 1;
+    else
+      c++;
+  }
+
+  if (bufp) *bufp = buf;
+  if (line) *line = lo + 1;
+  if (col)  *col  = c;
+  return 0;
+}
+
+void src_reset(void) {
+  for (uvar i = 0; i < SrcCnt; i++) {
+    free(SrcBufs[i]->lines);
+    SrcBufs[i]->lines = NULL;
+  }
+  SrcCnt  = 0;
+  SrcNext = SRCLOC_NONE + 1;
+}
+
+void src_free(void) {
+  src_reset();
+  for (uvar i = 0; i < SrcMade; i++)
+    free(SrcBufs[i]);
+  free(SrcBufs);
+  SrcBufs  = NULL;
+  SrcMade  = 0;
+  SrcAlloc = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef _ZNC_SRCMGR_H
+#define _ZNC_SRCMGR_H
+#include "types.h"
+#include <stdint.h>
+
+// the source manager. every loaded buffer owns a range of one global
+// 32-bit location space, so a source location is a single integer that
+// maps back to its buffer, line and column on demand
+
+// a location in the global space
+typedef uint32_t SrcLoc;
+
+// no location, the space starts after it
+#define SRCLOC_NONE 0
+
+typedef struct SrcBuffer {
+  char *name;           /* name of the buffer, usually the path */
+  char *text;           /* NUL-terminated contents, owned by the caller */
+  uvar len;             /* length of text */
+  SrcLoc base;          /* location of the first byte */
+  uvar *lines;          /* offsets of line starts, built on first use */
+  uvar lcnt;            /* number of lines */
+} SrcBuffer;
+
+/* register a buffer, it gets len + 1 locations (the last one is its
+   end). returns NULL if the location space is full */
+SrcBuffer *src_add(char *name, char *text, uvar len);
+
+/* find the buffer that holds a location, or NULL */
+SrcBuffer *src_find(SrcLoc loc);
+
+/* resolve a location to its buffer, line and col (tabs expanded),
+   returns 0 if succeded */
+int src_getloc(SrcLoc loc, SrcBuffer **buf, uvar *line, uvar *col);
+
+/* forget every buffer, the locations handed out become invalid. the
+   memory is kept for the next buffers */
+void src_reset(void);
+
+/* forget every buffer and release the memory */
+void src_free(void);
+
+#endif // _ZNC_SRCMGR_H
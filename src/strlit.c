@@ -0,0 +1,184 @@
+#include "strlit.h"
+#include "scan.h"
+#include "arena.h"
+#include "types.h"
+#include <stdint.h>
+#include <string.h>
+
+// length of the utf-8 sequence at p, 0 if it is not valid. the literal
+// always ends with an ascii quote, so this never reads past it
+static uvar utf8_seqlen(const unsigned char *p) {
+  unsigned char c = p[0];
+  if (c < 0x80)
+    return 1;
+  if (c >= 0xC2 && c <= 0xDF)
+    return (p[1] & 0xC0) == 0x80 ? 2 : 0;
+
+  // the bounds of the second byte rule out overlongs and surrogates
+  unsigned char lo = 0x80, hi = 0xBF;
+  uvar len;
+  if (c >= 0xE0 && c <= 0xEF) {
+    len = 3;
+    if (c == 0xE0) lo = 0xA0;
+    if (c == 0xED) hi = 0x9F;
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    len = 4;
+    if (c == 0xF0) lo = 0x90;
+    if (c == 0xF4) hi = 0x8F;
+  } else {
+    return 0;
+  }
+  if (p[1] < lo || p[1] > hi)
+    return 0;
+  for (uvar i = 2; i < len; i++)
+    if ((p[i] & 0xC0) != 0x80)
+      return 0;
+  return len;
+}
+
+static uvar utf8_encode(uint32_t cp, char *out) {
+  if (cp < 0x80) {
+    out[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char)(0xC0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (cp >> 18));
+  out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+static int hexval(char ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+  return -1;
+}
+
+// decode the escape after the '\' at p into out, returns the end of the
+// escape or NULL if it is not valid. *n gets the bytes written
+static char *str_escape(char *p, char *out, uvar *n) {
+  *n = 1;
+  switch (*p) {
+    case 'b':  *out = '\b';   return p + 1;
+    case 'e':  *out = '\033'; return p + 1;
+    case 't':  *out = '\t';   return p + 1;
+    case 'r':  *out = '\r';   return p + 1;
+    case 'n':  *out = '\n';   return p + 1;
+    case '\\': *out = '\\';   return p + 1;
+    case '"':  *out = '"';    return p + 1;
+    case '\'': *out = '\'';   return p + 1;
+
+    // \uXXXX and \u{X...}, a code point as utf-8
+    case 'u': {
+      uint32_t cp = 0;
+      p++;
+      if (*p == '{') {
+        int digits = 0;
+        for (p++; *p != '}'; p++, digits++) {
+          int d = hexval(*p);
+          if (d < 0 || digits == 6)
+            return NULL;
+          cp = cp << 4 | d;
+        }
+        if (digits == 0)
+          return NULL;
+        p++;
+      } else {
+        for (int i = 0; i < 4; i++, p++) {
+          int d = hexval(*p);
+          if (d < 0)
+            return NULL;
+          cp = cp << 4 | d;
+        }
+      }
+      if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        return NULL;
+      *n = utf8_encode(cp, out);
+      return p;
+    }
+
+    // \OOO up to \377 and \[4-7]O, a raw byte
+    default: {
+      if (*p < '0' || *p > '7')
+        return NULL;
+      int max = *p <= '3' ? 3 : 2;
+      unsigned val = 0;
+      for (int i = 0; i < max && *p >= '0' && *p <= '7'; i++, p++)
+        val = val << 3 | (*p - '0');
+      *out = (char)val;
+      return p;
+    }
+  }
+}
+
+StrStatus str_decode(char *text, uvar len, Arena *arena,
+    char **out, uvar *olen, uvar *err) {
+  // without the quotes
+  char *start = text + 1;
+  char *end = text + len - 1;
+  char *buf = NULL;
+  uvar w = 0;
+
+  // runs of plain ascii are skipped in bulk, copied only once there
+  // is an escape
+  char *run = start;
+  char *p = start;
+  for (;;) {
+    p = scan_strrun(p);
+    if (p >= end)
+      break;
+
+    // multi-byte characters stay in the run
+    if (*p != '\\') {
+      uvar n = utf8_seqlen((unsigned char*)p);
+      if (n == 0) {
+        *err = p - text;
+        return STR_BADUTF8;
+      }
+      p += n;
+      continue;
+    }
+
+    // the decoded text is never longer than the source
+    if (!buf) {
+      buf = (char*)arena_reqm(arena, end - start);
+      if (!buf)
+        return STR_NOMEM;
+    }
+    memcpy(buf + w, run, p - run);
+    w += p - run;
+
+    uvar n;
+    char *next = str_escape(p + 1, buf + w, &n);
+    if (!next || next > end) {
+      *err = p - text;
+      return STR_BADESC;
+    }
+    w += n;
+    run = p = next;
+  }
+
+  // no escapes, a view into the source
+  if (!buf) {
+    *out = start;
+    *olen = end - start;
+    return STR_OK;
+  }
+  memcpy(buf + w, run, end - run);
+  w += end - run;
+  *out = buf;
+  *olen = w;
+  return STR_OK;
+}
@@ -0,0 +1,21 @@
+#ifndef _ZNC_STRLIT_H
+#define _ZNC_STRLIT_H
+#include "types.h"
+#include "arena.h"
+
+// decoding of string literals into their final bytes
+
+typedef enum {
+  STR_OK = 0,
+  STR_BADESC,           /* unknown or malformed escape sequence */
+  STR_BADUTF8,          /* the source is not valid utf-8 */
+  STR_NOMEM,            /* the arena is out of memory */
+} StrStatus;
+
+/* decode a string literal token (quotes included). literals without
+   escapes stay views into text, others are decoded into the arena. on
+   error, *err gets the offset into text of the bad sequence */
+StrStatus str_decode(char *text, uvar len, Arena *arena,
+    char **out, uvar *olen, uvar *err);
+
+#endif // _ZNC_STRLIT_H
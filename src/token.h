@@ -13,10 +13,35 @@ typedef enum {
   TOKEN_DELIMETER,
   TOKEN_STRING,
   TOKEN_INTEGER,
+  TOKEN_FLOAT,
 } TokenType;
 
+// bracket and delimeter kinds
+typedef enum {
+  PUNC_UNK = 0,
+  PUNC_LPAREN,   // (
+  PUNC_RPAREN,   // )
+  PUNC_LBRACE,   // {
+  PUNC_RBRACE,   // }
+  PUNC_LSQUARE,  // [
+  PUNC_RSQUARE,  // ]
+  PUNC_SEMI,     // ;
+} PunctType;
+
+// integer literal kinds, by radix
+typedef enum {
+  INTL_UNK = 0,
+  INTL_DEC,      // [1-9][0-9_]* and 0
+  INTL_HEX,      // 0x[0-9a-fA-F_]+
+  INTL_BIN,      // 0b[01]+
+  INTL_OCT,      // 0o[0-7]+ and 0[0-7]+
+} IntKind;
+
 // token type names
 extern const char *TokenTypeNames[];
 
+// bracket and delimeter names
+extern const char *PunctNames[];
+
 #endif // _ZNC_TOKEN_H
 
@@ -3,8 +3,9 @@
 #include "types.h"
 #include "operator.h"
 #include "keyword.h"
+#include "scan.h"
+#include "pipeline.h"
 #include <stdbool.h>
-#include <ctype.h>
 
 const char *TokenTypeNames[] = {
   [TOKEN_EOF]        = "eof",
@@ -16,172 +17,438 @@ const char *TokenTypeNames[] = {
   [TOKEN_DELIMETER]  = "delimeter",
   [TOKEN_STRING]     = "string literal",
   [TOKEN_INTEGER]    = "integer literal",
+  [TOKEN_FLOAT]      = "float literal",
 };
 
-void lexer_tokenize(Lexer *lex) {
-  while (!lex->eof) {
-    // skip whitespace
-    while (
-        (*lex->lex == ' ' || *lex->lex == '\t' || *lex->lex == '\n' ||
-        *lex->lex == '\r') && *lex->lex != '\0'
-    ) lexer_inc(lex);
-
-    // eof
-    if (*lex->lex == '\0') {
-      Token tok = {
-        .lexer  = lex,
-        .type   = TOKEN_EOF,
-        .lexeme = lex->lex,
-        .len    = 0,
-        .line   = lex->line,
-        .col    = lex->col,
-        .pos    = lex->pos,
-      };
-      lexer_emit(lex, &tok);
-      lex->eof = true;
-      return;
-    }
+const char *PunctNames[] = {
+  [PUNC_UNK]         = "<unknown>",
+  [PUNC_LPAREN]      = "(",
+  [PUNC_RPAREN]      = ")",
+  [PUNC_LBRACE]      = "{",
+  [PUNC_RBRACE]      = "}",
+  [PUNC_LSQUARE]     = "[",
+  [PUNC_RSQUARE]     = "]",
+  [PUNC_SEMI]        = ";",
+};
+
+// character classes, used to dispatch on the first char of a token
+typedef enum {
+  CC_OTHER = 0,         /* not valid in source text */
+  CC_NUL,               /* the NUL-terminator */
+  CC_SPACE,             /* whitespace */
+  CC_ALPHA,             /* identifier start */
+  CC_DIGIT,             /* integer literal start */
+  CC_QUOTE,             /* string literal start */
+  CC_OPER,              /* operator start, or a comment */
+  CC_BRACKET,           /* brackets */
+  CC_DELIM,             /* delimeter */
+} CharClassType;
+
+#define CC_CLASS 0x7f   /* mask of the class bits */
+#define CC_IDENT 0x80   /* flag for identifier continuation chars */
+
+#define XX CC_OTHER
+#define NL CC_NUL
+#define WS CC_SPACE
+#define AL (CC_ALPHA | CC_IDENT)
+#define DG (CC_DIGIT | CC_IDENT)
+#define QT CC_QUOTE
+#define OP CC_OPER
+#define BR CC_BRACKET
+#define DL CC_DELIM
+
+static const unsigned char CharClass[256] = {
+  /* 0x00 */ NL, XX, XX, XX, XX, XX, XX, XX, XX, WS, WS, XX, XX, WS, XX, XX,
+  /* 0x10 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0x20 */ WS, OP, QT, XX, XX, OP, OP, XX, BR, BR, OP, OP, OP, OP, OP, OP,
+  /* 0x30 */ DG, DG, DG, DG, DG, DG, DG, DG, DG, DG, OP, DL, OP, OP, OP, OP,
+  /* 0x40 */ XX, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+  /* 0x50 */ AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, BR, XX, BR, OP, AL,
+  /* 0x60 */ XX, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+  /* 0x70 */ AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, BR, OP, BR, OP, XX,
+  /* 0x80 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0x90 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0xa0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0xb0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0xc0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0xd0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0xe0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+  /* 0xf0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+
+#undef XX
+#undef NL
+#undef WS
+#undef AL
+#undef DG
+#undef QT
+#undef OP
+#undef BR
+#undef DL
+
+#define charclass(ch) (CharClass[(unsigned char)(ch)] & CC_CLASS)
+#define isidentch(ch) (CharClass[(unsigned char)(ch)] & CC_IDENT)
+
+// end of an identifier starting at text
+static char *scan_ident(char *text) {
+  while (isidentch(*text))
+    text++;
+  return text;
+}
+
+// end of a decimal integer starting at text
+static char *scan_int(char *text) {
+  while (charclass(*text) == CC_DIGIT || *text == '_')
+    text++;
+  return text;
+}
+
+#define ishexch(ch) (charclass(ch) == CC_DIGIT || \
+    (((ch) | 0x20) >= 'a' && ((ch) | 0x20) <= 'f'))
+
+// end of an integer literal starting at text, kind gets its radix
+static char *scan_intlit(char *text, IntKind *kind) {
+  *kind = INTL_DEC;
+  if (*text != '0')
+    return scan_int(text);
+
+  char *p = text + 2;
+  switch (text[1]) {
+    case 'x':
+      while (ishexch(*p) || *p == '_') p++;
+      *kind = INTL_HEX;
+      break;
+    case 'b':
+      while (*p == '0' || *p == '1') p++;
+      *kind = INTL_BIN;
+      break;
+    case 'o':
+      while (*p >= '0' && *p <= '7') p++;
+      *kind = INTL_OCT;
+      break;
+    default:
+      // legacy octal, or just a zero
+      p = text + 1;
+      while (*p >= '0' && *p <= '7') p++;
+      *kind = p > text + 1 ? INTL_OCT : INTL_DEC;
+      return p;
+  }
+
+  // a prefix without digits is only the zero
+  if (p == text + 2) {
+    *kind = INTL_DEC;
+    return text + 1;
+  }
+  return p;
+}
+
+// end of a float literal ([1-9][0-9]*|0|)\.[0-9]* at text, or text if
+// there is none there
+static char *scan_float(char *text) {
+  char *p = text;
+  if (*p == '0')
+    p++;
+  else
+    while (charclass(*p) == CC_DIGIT)
+      p++;
+  if (*p != '.')
+    return text;
+  p++;
+  while (charclass(*p) == CC_DIGIT)
+    p++;
+  // a lone '.' is the member operator
+  return p - text > 1 ? p : text;
+}
+
+// end of a number literal at text, type and kind get what it is
+static char *scan_number(char *text, TokenType *type, IntKind *kind) {
+  char *end = scan_float(text);
+  if (end != text) {
+    *type = TOKEN_FLOAT;
+    *kind = INTL_UNK;
+    return end;
+  }
+  *type = TOKEN_INTEGER;
+  return scan_intlit(text, kind);
+}
+
+// end of the body of a string literal whose opening quote is at text,
+// that is the closing quote or the char that stopped it
+static char *scan_string(char *text) {
+  char *end = text + 1;
+  for (;;) {
+    end = scan_strbody(end);
+    if (*end != '\\')
+      return end;
+    // escapes (they are decoded and checked by the parser)
+    end++;
+    if (*end != '\n' && *end != '\r' && *end != '\0')
+      end++;
+  }
+}
+
+// end of an unknown token starting at text
+static char *scan_unknown(char *text) {
+  while (charclass(*text) != CC_SPACE && charclass(*text) != CC_NUL)
+    text++;
+  return text;
+}
 
-    // skip single line comments
-    if (*lex->lex == '/' && *(lex->lex + 1) == '/') {
-      while (*lex->lex != '\n' && *lex->lex != '\0')
-        lexer_inc(lex);
-      continue;
+// fill a token, lengths that do not fit are re-measured by lexer_toklen()
+static void mktok(Lexer *lex, Token *tok, TokenType type, int sub, char *start, uvar len) {
+  tok->type = type;
+  tok->sub  = sub;
+  tok->pos  = start - lex->input;
+  tok->len  = len < TOKEN_LONGLEN ? len : TOKEN_LONGLEN;
+}
+
+uvar lexer_toklen(Lexer *lex, Token *tok) {
+  if (!lex || !tok)
+    return 0;
+  if (tok->len < TOKEN_LONGLEN)
+    return tok->len;
+
+  char *start = lex->input + tok->pos;
+  switch (tok->type) {
+    case TOKEN_IDENTIFIER:
+    case TOKEN_KEYWORD:
+      return scan_ident(start) - start;
+    case TOKEN_INTEGER:
+    case TOKEN_FLOAT: {
+      TokenType type;
+      IntKind kind;
+      return scan_number(start, &type, &kind) - start;
     }
+    case TOKEN_STRING: {
+      char *end = scan_string(start);
+      return end - start + (*end == '"');
+    }
+    case TOKEN_ERROR:
+      // the only long errors are unterminated strings, bad numbers and
+      // unknown tokens
+      if (*start == '"')
+        return scan_string(start) - start;
+      if (charclass(*start) == CC_DIGIT || *start == '.') {
+        TokenType type;
+        IntKind kind;
+        return scan_ident(scan_number(start, &type, &kind)) - start;
+      }
+      return scan_unknown(start) - start;
+    default:
+      return tok->len;
+  }
+}
 
-    // skip multiline comments
-    if (*lex->lex == '/' && *(lex->lex + 1) == '*') {
-      while ((*lex->lex != '*' || *(lex->lex + 1) != '/') && *lex->lex != '\0')
-        lexer_inc(lex);
-      lexer_inc(lex); // end '*'
-      lexer_inc(lex); // end '/'
-      continue;
+uvar lexer_spanat(char *text) {
+  if (!text)
+    return 0;
+  switch (charclass(*text)) {
+    case CC_NUL:
+      return 0;
+    case CC_ALPHA:
+      return scan_ident(text) - text;
+    case CC_DIGIT: {
+      // a name glued to a number is part of the bad token
+      TokenType type;
+      IntKind kind;
+      return scan_ident(scan_number(text, &type, &kind)) - text;
+    }
+    case CC_QUOTE: {
+      char *end = scan_string(text);
+      return end - text + (*end == '"');
     }
+    case CC_OPER: {
+      if (*text == '.' && charclass(text[1]) == CC_DIGIT) {
+        TokenType type;
+        IntKind kind;
+        return scan_ident(scan_number(text, &type, &kind)) - text;
+      }
+      OperatorType op;
+      return scanop(text, &op);
+    }
+    case CC_BRACKET:
+    case CC_DELIM:
+      return 1;
+    default:
+      return scan_unknown(text) - text;
+  }
+}
+
+void lexer_report(Lexer *lex, Token *tok) {
+  if (!lex || !tok || tok->type != TOKEN_ERROR)
+    return;
+  // the token is lexed once, a speculative parse must not drop its error
+  uvar mute = lex->mute;
+  lex->mute = 0;
+
+  // only strings can be unterminated, and numbers run into names
+  char ch = lex->input[tok->pos];
+  if (ch == '"')
+    print_token(lex, tok, "syntax error: unterminated string literal\n");
+  else if (charclass(ch) == CC_DIGIT || ch == '.')
+    print_token(lex, tok, "syntax error: invalid numeric literal\n");
+  else
+    print_token(lex, tok, "syntax error: unknown token\n");
+
+  lex->mute = mute;
+}
+
+// append a token, the common case skips the checks of lexer_emit()
+static inline void pushtok(Lexer *lex, Token *tok) {
+  if (!lex->stream && lex->tcnt < lex->talloc)
+    lex->toks[lex->tcnt++] = *tok;
+  else
+    lexer_emit(lex, tok);
+}
+
+void lexer_tokenize(Lexer *lex) {
+  // tokens come from the lexer thread
+  if (lex->pipe) {
+    lexer_pull(lex);
+    return;
+  }
+  lexer_scan(lex, 1);
+}
+
+// lex a number literal at start, a name char that sticks to it (like
+// 08 or 0x1g) makes it an error
+static void lex_number(Lexer *lex, char *start) {
+  Token tok;
+  TokenType type;
+  IntKind kind;
+  char *end = scan_number(start, &type, &kind);
+  if (isidentch(*end)) {
+    lex->lex = scan_ident(end);
+    mktok(lex, &tok, TOKEN_ERROR, 0, start, lex->lex - start);
+    lexer_report(lex, &tok);
+    pushtok(lex, &tok);
+    lex->eof = true;
+    return;
+  }
+  lex->lex = end;
+  mktok(lex, &tok, type, kind, start, end - start);
+  pushtok(lex, &tok);
+}
+
+uvar lexer_scan(Lexer *lex, uvar max) {
+  uvar cnt = 0;
+  while (!lex->eof && cnt < max) {
+    // skip whitespace
+    lex->lex = scan_space(lex->lex);
 
     // start token
-    Token tok = {
-      .lexer  = lex,
-      .type   = TOKEN_ERROR,
-      .lexeme = lex->lex,
-      .len    = 0,
-      .line   = lex->line,
-      .col    = lex->col,
-      .pos    = lex->pos,
-    };
-
-    // identifier token
-    if (isalpha(*lex->lex) || *lex->lex == '_') {
-      tok.type = TOKEN_IDENTIFIER;
-      while (isalnum(*lex->lex) || *lex->lex == '_') {
-        tok.len++;
-        lexer_inc(lex);
+    char *start = lex->lex;
+    Token tok;
+
+    switch (charclass(*start)) {
+      // eof
+      case CC_NUL:
+        mktok(lex, &tok, TOKEN_EOF, 0, start, 0);
+        pushtok(lex, &tok);
+        lex->eof = true;
+        break;
+
+      // identifier token
+      case CC_ALPHA: {
+        lex->lex = scan_ident(start + 1);
+        uvar len = lex->lex - start;
+        // a keyword!
+        KeywordType kwd = findkwd(start, len);
+        mktok(lex, &tok, kwd != KWD_UNK ? TOKEN_KEYWORD : TOKEN_IDENTIFIER,
+            kwd, start, len);
+        pushtok(lex, &tok);
+        break;
       }
-      // a keyword!
-      if (iskwd(tok.lexeme) == tok.len)
-        tok.type = TOKEN_KEYWORD;
-      lexer_emit(lex, &tok);
-      break;
-    }
 
-    // operators
-    uvar oplen = isop(lex->lex);
-    if (oplen > 0) {
-      tok.type = TOKEN_OPERATOR;
-      tok.len = oplen;
-      lex->lex += oplen;
-      lex->col += oplen;
-      lex->pos += oplen;
-      lexer_emit(lex, &tok);
-      break;
-    }
+      // operators and comments
+      case CC_OPER: {
+        // skip single line comments
+        if (*start == '/' && *(start + 1) == '/') {
+          lex->lex = scan_line(start + 2);
+          continue;
+        }
 
-    // brackets
-    if (
-      *lex->lex == '(' || *lex->lex == ')' ||
-      *lex->lex == '{' || *lex->lex == '}' ||
-      *lex->lex == '[' || *lex->lex == ']'
-    ) {
-      tok.type = TOKEN_BRACKET;
-      tok.len = 1;
-      lexer_inc(lex);
-      lexer_emit(lex, &tok);
-      break;
-    }
+        // skip multiline comments
+        if (*start == '/' && *(start + 1) == '*') {
+          char *end = scan_cmtend(start + 2);
+          if (*end != '\0') end += 2; // end '*' '/'
+          lex->lex = end;
+          continue;
+        }
 
-    // delimeter
-    if (*lex->lex == ';') {
-      tok.type = TOKEN_DELIMETER;
-      tok.len = 1;
-      lexer_inc(lex);
-      lexer_emit(lex, &tok);
-      break;
-    }
+        // float literal without the integer part
+        if (*start == '.' && charclass(start[1]) == CC_DIGIT) {
+          lex_number(lex, start);
+          break;
+        }
 
-    // string literal
-    if (*lex->lex == '"') {
-      tok.type = TOKEN_STRING;
-      lexer_inc(lex);
-      tok.len++;
-      bool escape = false;
-
-      // iterate until the end of the string
-      while (
-        (escape || *lex->lex != '"') &&
-        *lex->lex != '\n' &&
-        *lex->lex != '\r' &&
-        *lex->lex != '\0'
-      ) {
-
-        // escapes (they will be validated at codegen)
-        if (escape)
-          escape = false;
-        else if (*lex->lex == '\\')
-          escape = true;
-
-        tok.len++;
-        lexer_inc(lex);
+        OperatorType op;
+        uvar len = scanop(start, &op);
+        lex->lex += len;
+        mktok(lex, &tok, TOKEN_OPERATOR, op, start, len);
+        pushtok(lex, &tok);
+        break;
       }
 
-      // check the closing quote
-      if (*lex->lex != '"') {
-        print_token(&tok, "syntax error: unterminated string literal\n");
-        tok.type = TOKEN_ERROR;
-        lexer_emit(lex, &tok);
-        lex->eof = true;
+      // brackets
+      case CC_BRACKET: {
+        PunctType punc = PUNC_UNK;
+        switch (*start) {
+          case '(': punc = PUNC_LPAREN;  break;
+          case ')': punc = PUNC_RPAREN;  break;
+          case '{': punc = PUNC_LBRACE;  break;
+          case '}': punc = PUNC_RBRACE;  break;
+          case '[': punc = PUNC_LSQUARE; break;
+          case ']': punc = PUNC_RSQUARE; break;
+        }
+        lex->lex++;
+        mktok(lex, &tok, TOKEN_BRACKET, punc, start, 1);
+        pushtok(lex, &tok);
         break;
       }
 
-      // for the closing quote
-      lexer_inc(lex);
-      tok.len++;
-      lexer_emit(lex, &tok);
-      break;
-    }
+      // delimeter
+      case CC_DELIM:
+        lex->lex++;
+        mktok(lex, &tok, TOKEN_DELIMETER, PUNC_SEMI, start, 1);
+        pushtok(lex, &tok);
+        break;
 
-    // integer literal
-    if (isdigit(*lex->lex)) {
-      tok.type = TOKEN_INTEGER;
-      while (isdigit(*lex->lex) || *lex->lex == '_') {
-        tok.len++;
-        lexer_inc(lex);
+      // string literal
+      case CC_QUOTE: {
+        lex->lex = scan_string(start);
+
+        // check the closing quote
+        if (*lex->lex != '"') {
+          mktok(lex, &tok, TOKEN_ERROR, 0, start, lex->lex - start);
+          lexer_report(lex, &tok);
+          pushtok(lex, &tok);
+          lex->eof = true;
+          break;
+        }
+
+        // for the closing quote
+        lex->lex++;
+        mktok(lex, &tok, TOKEN_STRING, 0, start, lex->lex - start);
+        pushtok(lex, &tok);
+        break;
       }
-      lexer_emit(lex, &tok);
-      break;
-    }
 
-    // unknown token
-    while (
-      *lex->lex != ' ' && *lex->lex != '\t' && *lex->lex != '\n' &&
-      *lex->lex != '\r' && *lex->lex != '\0'
-    ) {
-      tok.len++;
-      lexer_inc(lex);
+      // integer or float literal
+      case CC_DIGIT:
+        lex_number(lex, start);
+        break;
+
+      // unknown token
+      default:
+        lex->lex = scan_unknown(start);
+        mktok(lex, &tok, TOKEN_ERROR, 0, start, lex->lex - start);
+        lexer_report(lex, &tok);
+        pushtok(lex, &tok);
+        lex->eof = true;
+        break;
     }
-    print_token(&tok, "syntax error: unknown token\n");
-    tok.type = TOKEN_ERROR;
-    lexer_emit(lex, &tok);
-    lex->eof = true;
-    break;
+    cnt++;
   }
+  return cnt;
 }
-
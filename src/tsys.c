@@ -1,4 +1,5 @@
 #include "tsys.h"
+#include "memstat.h"
 #include <stdlib.h>
 #include <stdbool.h>
 
@@ -31,6 +32,8 @@ static TypeFuncArg *typesig_argast(ASTFuncArgDef *node, bool *err) {
     *err = true;
     return NULL;
   }
+  memstat_add(sigs, 1);
+  memstat_add(sigbytes, sizeof(TypeFuncArg));
 
   TypeSig *type = typesig_fromast(node->type);
   if (!type) {
@@ -59,6 +62,8 @@ TypeSig *typesig_fromast(ASTTypeRef *node) {
 
   TypeSig *sig = (TypeSig*)malloc(sizeof(TypeSig));
   if (!sig) return NULL;
+  memstat_add(sigs, 1);
+  memstat_add(sigbytes, sizeof(TypeSig));
 
   switch (node->type) {
     case AST_TYPE_PRIMITIVE:
@@ -1,37 +1,152 @@
+// for mmap() flags and the posix io api
+#define _DEFAULT_SOURCE
 #include "util.h"
 #include "types.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-char *util_readfile(const char *path) {
-  if (!path)
-    return NULL;
+// open path for reading, "-" is stdin
+static int util_open(const char *path) {
+  if (strcmp(path, "-") == 0)
+    return STDIN_FILENO;
+  return open(path, O_RDONLY);
+}
 
-  // try to open file
-  FILE *fp = fopen(path, "r");
-  if (!fp)
+static void util_close(int fd) {
+  if (fd != STDIN_FILENO)
+    close(fd);
+}
+
+// size of fd if it is a regular file, 0 otherwise
+static uvar util_regsize(int fd, int *reg) {
+  struct stat st;
+  *reg = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  return *reg ? (uvar)st.st_size : 0;
+}
+
+// read fd until eof into a growing buffer, hint is the expected size
+static char *util_readfd(int fd, uvar hint, uvar *len) {
+  // +2: the NUL-terminator, and a spare byte so reading a file of the
+  // expected size sees eof without growing the buffer
+  uvar cap = hint ? hint + 2 : UTIL_READCHUNK;
+  uvar used = 0;
+  char *buf = (char*)malloc(cap);
+  if (!buf)
     return NULL;
 
-  // get the size of the file
-  fseek(fp, 0, SEEK_END);
-  uvar size = ftell(fp);
-  fseek(fp, 0, SEEK_SET);
+  for (;;) {
+    // full, keep room for the NUL-terminator
+    if (cap - used <= 1) {
+      char *tmp = (char*)realloc(buf, cap * 2);
+      if (!tmp) {
+        free(buf);
+        return NULL;
+      }
+      buf = tmp;
+      cap *= 2;
+    }
 
-  // allocate memory for string, +1 for the NUL-terminator
-  char *text = (char*)malloc(size + 1);
-  if (!text) {
-    fclose(fp);
+    // short reads are normal on pipes, just go on
+    ssize_t n = read(fd, buf + used, cap - used - 1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      free(buf);
+      return NULL;
+    }
+    if (n == 0)
+      break;
+    used += n;
+  }
+
+  buf[used] = '\0';
+  *len = used;
+  return buf;
+}
+
+// map a regular file with at least one zeroed byte after its contents
+static char *util_mapfd(int fd, uvar size, uvar *maplen) {
+  long page = sysconf(_SC_PAGESIZE);
+  if (page <= 0)
     return NULL;
+
+  // reserve the pages for the file plus the terminator, then map the
+  // file over them. the tail of the last file page is zero-filled, and
+  // when the size is page aligned the extra anonymous page is the NUL
+  uvar total = (size / page + 1) * page;
+  char *base = (char*)mmap(NULL, total, PROT_READ,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return NULL;
+  if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(base, total);
+    return NULL;
+  }
+
+  *maplen = total;
+  return base;
+}
+
+int util_loadfile(SrcFile *file, const char *path) {
+  if (!file || !path)
+    return 1;
+  file->text   = NULL;
+  file->len    = 0;
+  file->maplen = 0;
+
+  int fd = util_open(path);
+  if (fd < 0)
+    return 1;
+
+  // map big regular files, pipes and small files are copied
+  int reg;
+  uvar size = util_regsize(fd, &reg);
+  if (reg && size >= UTIL_MAPMIN) {
+    file->text = util_mapfd(fd, size, &file->maplen);
+    if (file->text)
+      file->len = size;
   }
-  text[size] = '\0';
+  if (!file->text)
+    file->text = util_readfd(fd, size, &file->len);
+
+  util_close(fd);
+  return !file->text;
+}
+
+void util_unloadfile(SrcFile *file) {
+  if (!file || !file->text)
+    return;
+  if (file->maplen)
+    munmap(file->text, file->maplen);
+  else
+    free(file->text);
+  file->text   = NULL;
+  file->len    = 0;
+  file->maplen = 0;
+}
 
-  // read file
-  fread(text, 1, size, fp);
-  fclose(fp);
+char *util_readfile(const char *path) {
+  if (!path)
+    return NULL;
+
+  // try to open file
+  int fd = util_open(path);
+  if (fd < 0)
+    return NULL;
+
+  int reg;
+  uvar len;
+  char *text = util_readfd(fd, util_regsize(fd, &reg), &len);
+  util_close(fd);
   return text;
 }
 
 void pview(char *str, uvar len) {
   fwrite(str, 1, len, stdout);
 }
-
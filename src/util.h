@@ -2,11 +2,30 @@
 #define _ZNC_UTIL_H
 #include "types.h"
 
-/* read a text file */
+// files at least this big are mapped instead of copied
+#define UTIL_MAPMIN (64 * 1024)
+
+// first buffer size when reading from a pipe
+#define UTIL_READCHUNK (64 * 1024)
+
+// a loaded source file
+typedef struct {
+  char *text;           /* contents, always NUL-terminated */
+  uvar len;             /* length of text */
+  uvar maplen;          /* size of the mapping, 0 if text was allocated */
+} SrcFile;
+
+/* load a source file, big files are mapped to memory and "-" reads
+   stdin. returns 0 if succeded */
+int util_loadfile(SrcFile *file, const char *path);
+
+/* release a file from util_loadfile() */
+void util_unloadfile(SrcFile *file);
+
+/* read a text file into an allocated copy, "-" reads stdin */
 char *util_readfile(const char *path);
 
 /* print string up to a given length */
 void pview(char *str, uvar len);
 
 #endif // _ZNC_UTIL_H
-
@@ -0,0 +1,62 @@
+#include "znc.h"
+#include "types.h"
+#include "lexer.h"
+#include "arena.h"
+#include "srcmgr.h"
+#include "ast.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+ZncContext *znc_init(bool vm) {
+  ZncContext *ctx = (ZncContext*)malloc(sizeof(ZncContext));
+  if (!ctx) {
+    fprintf(stderr, "znc: out of memory\n");
+    return NULL;
+  }
+  ctx->arena = vm ? arena_initvm(0, false) : arena_init(ARENA_MINSIZE);
+  if (!ctx->arena) {
+    free(ctx);
+    return NULL;
+  }
+  ctx->ready = false;
+  ctx->quiet = false;
+  ctx->maxdepth = LEXER_MAXDEPTH;
+  ctx->maxerrs = LEXER_MAXERRS;
+  return ctx;
+}
+
+void znc_free(ZncContext *ctx) {
+  if (!ctx) return;
+  if (ctx->ready)
+    lexer_free(&ctx->lex);
+  arena_free(ctx->arena);
+  free(ctx);
+}
+
+ASTRoot *znc_parse(ZncContext *ctx, char *name, char *src) {
+  if (!ctx || !name || !src)
+    return NULL;
+
+  // drop the last tree and its locations, keeping the memory
+  arena_reset(ctx->arena);
+  src_reset();
+
+  // the token array is made once and grows to the largest input
+  if (!ctx->ready) {
+    if (lexer_init(&ctx->lex, name, src)) {
+      free(ctx->lex.toks);
+      return NULL;
+    }
+    ctx->ready = true;
+  }
+  else if (lexer_reset(&ctx->lex, name, src))
+    return NULL;
+  ctx->lex.quiet = ctx->quiet;
+  ctx->lex.maxdepth = ctx->maxdepth;
+  ctx->lex.maxerrs = ctx->maxerrs;
+
+  if (lexer_tokenize_all(&ctx->lex))
+    return NULL;
+  return parse(&ctx->lex, ctx->arena);
+}
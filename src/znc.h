@@ -0,0 +1,36 @@
+#ifndef _ZNC_ZNC_H
+#define _ZNC_ZNC_H
+#include "types.h"
+#include "lexer.h"
+#include "arena.h"
+#include "ast.h"
+#include <stdbool.h>
+
+// the library interface of the front end (libznc.a). a context owns a
+// lexer and an arena that are reused from one compilation to the next,
+// once they have grown to the usual input size a compilation makes no
+// allocations. the source manager is process-wide, so contexts must not
+// compile at the same time
+
+typedef struct ZncContext {
+  Lexer lex;            /* lexer, keeps its token array between inputs */
+  Arena *arena;         /* nodes of the last tree */
+  bool ready;           /* whether lex has been initialized */
+  bool quiet;           /* do not print diagnostics (set by the caller) */
+  uvar maxdepth;        /* nesting limit of the parser, 0 for none (set by the caller) */
+  uvar maxerrs;         /* errors reported before giving up, 0 for no limit (set by the caller) */
+} ZncContext;
+
+/* create a context, vm picks the reserve/commit arena. returns NULL if
+   it failed */
+ZncContext *znc_init(bool vm);
+
+/* free a context and its last tree */
+void znc_free(ZncContext *ctx);
+
+/* parse a NUL-terminated source, returns the tree or NULL on error. the
+   tree and its source locations are valid until the next call, src must
+   outlive them */
+ASTRoot *znc_parse(ZncContext *ctx, char *name, char *src);
+
+#endif // _ZNC_ZNC_H
@@ -85,7 +85,7 @@ int main(void) {
 
 int TEST__register(const char *name, TEST__fn fn) {
   if (entriesCount >= entriesAlloc) {
-    testEntry *tmp = (testEntry*)realloc(entries, entriesAlloc * 2);
+    testEntry *tmp = (testEntry*)realloc(entries, sizeof(testEntry) * entriesAlloc * 2);
     if (!tmp) {
       msg("error: failed to register test: %s", name);
       return 1;
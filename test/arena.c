@@ -0,0 +1,104 @@
+#include "test.h"
+#include "../src/arena.h"
+#include "../src/ast.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+int test_arena(void) {
+  int fail = 0;
+  Arena *arena = arena_init(ARENA_MINSIZE);
+  if (!arena) return 1;
+
+  // odd sizes do not misalign the next allocation
+  char *a = (char*)arena_reqm(arena, 3);
+  char *b = (char*)arena_reqm(arena, 1);
+  fail |= !EXPECT_EQ((uintptr_t)a % ARENA_ALIGN, 0);
+  fail |= !EXPECT_EQ((uintptr_t)b % ARENA_ALIGN, 0);
+  fail |= !EXPECT_EQ(b - a, ARENA_ALIGN);
+
+  // a big request gets its own block, the current one keeps bumping
+  ArenaBlock *curr = arena->curr;
+  char *big = (char*)arena_reqm(arena, ARENA_MINSIZE);
+  char *c = (char*)arena_reqm(arena, 8);
+  fail |= !EXPECT_NE(big, NULL);
+  fail |= !EXPECT_EQ(arena->curr, curr);
+  fail |= !EXPECT_EQ(c - b, ARENA_ALIGN);
+
+  // filling the block moves the cursor to a new one
+  for (uvar i = 0; i < ARENA_MINSIZE / 64; i++)
+    arena_reqm(arena, 64);
+  fail |= !EXPECT_NE(arena->curr, curr);
+  fail |= !EXPECT_EQ(curr->next, arena->curr);
+
+  // the counters see all of it, and the tail left behind
+  aaloc(arena, ASTExpr);
+  ArenaStats st;
+  arena_stats(arena, &st);
+  fail |= !EXPECT_EQ(st.blocks, 3);
+  fail |= !EXPECT_EQ(st.kcnt[AK_ASTExpr], 1);
+  fail |= !EXPECT_EQ(st.kcnt[AK_RAW], ARENA_MINSIZE / 64 + 4);
+  fail |= !EXPECT_EQ(st.wasted, curr->alloc - curr->used);
+  fail |= !EXPECT_EQ(st.footprint, 3 * (sizeof(ArenaBlock) + ARENA_MINSIZE));
+  fail |= !EXPECT_EQ(st.peak, st.footprint);
+
+  // a reset keeps the regular blocks, filling them again makes none
+  ArenaBlock *second = arena->curr;
+  arena_reset(arena);
+  fail |= !EXPECT_EQ(arena->curr, arena->head);
+  fail |= !EXPECT_EQ(arena->big, NULL);
+  for (uvar i = 0; i < ARENA_MINSIZE / 64 + 1; i++)
+    arena_reqm(arena, 64);
+  fail |= !EXPECT_EQ(arena->curr, second);
+  fail |= !EXPECT_EQ(second->used, 64);
+  arena_stats(arena, &st);
+  fail |= !EXPECT_EQ(st.blocks, 2);
+  fail |= !EXPECT_EQ(st.allocs, ARENA_MINSIZE / 64 + 1);
+  fail |= !EXPECT_EQ(st.footprint, 2 * (sizeof(ArenaBlock) + ARENA_MINSIZE));
+
+  arena_free(arena);
+  return fail;
+}
+
+int test_arenavm(void) {
+  int fail = 0;
+  Arena *arena = arena_initvm(4 * ARENA_VMCOMMIT, false);
+  if (!EXPECT_NE(arena, NULL)) return 1;
+
+  // one contiguous block across commits, big requests included
+  char *first = (char*)arena_reqm(arena, 16);
+  char *last = first;
+  for (uvar i = 0; i < 2 * ARENA_VMCOMMIT / 64; i++)
+    last = (char*)arena_reqm(arena, 64);
+  char *big = (char*)arena_reqm(arena, ARENA_VMCOMMIT / 2);
+  fail |= !EXPECT_EQ(last - first, 2 * ARENA_VMCOMMIT - 64 + 16);
+  fail |= !EXPECT_EQ(big, last + 64);
+  fail |= !EXPECT_EQ(arena->head->next, NULL);
+  fail |= !EXPECT_EQ(arena->big, NULL);
+  memset(big, 0xaa, ARENA_VMCOMMIT / 2);
+
+  // a full range goes on with other blocks
+  char *over = (char*)arena_reqm(arena, 2 * ARENA_VMCOMMIT);
+  fail |= !EXPECT_NE(over, NULL);
+  fail |= !EXPECT_NE(arena->big, NULL);
+  ArenaStats st;
+  arena_stats(arena, &st);
+  fail |= !EXPECT_EQ(st.blocks, 2);
+
+  arena_free(arena);
+
+  // huge pages are only advised, the arena works either way
+  arena = arena_initvm(0, true);
+  fail |= !EXPECT_NE(arena, NULL);
+  fail |= !EXPECT_NE(aaloc(arena, ASTExpr), NULL);
+  arena_free(arena);
+  return fail;
+}
+
+int test(const char *name) {
+  TEST_REGISTER(test_arena);
+  TEST_REGISTER(test_arenavm);
+  TEST_RUN(test_arena);
+  TEST_RUN(test_arenavm);
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include "test.h"
+#include "../src/znc.h"
+#include "../src/flat.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int test_flat(void) {
+  int fail = 0;
+  ZncContext *ctx = znc_init(false);
+  if (!EXPECT_NE(ctx, NULL)) return 1;
+
+  char src[] =
+    "type ids = int[];\n"
+    "type fp = function(int)(int a);\n"
+    "enum E byte { A = 1, B = -2 }\n"
+    "function int f(int x, ids r...) {\n"
+    "  let float y = x > 0 ? 1.5 : g(x, k=\"a\\tb\");\n"
+    "  while (y < 100000000000000000000) y = y * 2;\n"
+    "  return <int>y;\n"
+    "}\n";
+  ASTRoot *root = znc_parse(ctx, "<test_flat>", src);
+  if (!EXPECT_NE(root, NULL)) {
+    znc_free(ctx);
+    return 1;
+  }
+
+  FlatAST ast;
+  if (!EXPECT_EQ(flat_build(&ast, root), 0)) {
+    znc_free(ctx);
+    return 1;
+  }
+
+  // children always come before their parents
+  uvar kinds[FLAT_ROOT + 1] = { 0 };
+  for (uint32_t i = 1; i < ast.cnt; i++) {
+    kinds[ast.kind[i]]++;
+    if (ast.kind[i] == FLAT_BINOP || ast.kind[i] == FLAT_CAST ||
+        ast.kind[i] == FLAT_WHILE)
+      fail |= !EXPECT_TRUE(ast.data[i].lhs < i && ast.data[i].rhs < i);
+  }
+  fail |= !EXPECT_EQ(ast.root, ast.cnt - 1);
+  fail |= !EXPECT_EQ(ast.extra[ast.data[ast.root].lhs], 4);
+  fail |= !EXPECT_EQ(kinds[FLAT_FUNC], 1);
+  fail |= !EXPECT_EQ(kinds[FLAT_PARAM], 3);
+  fail |= !EXPECT_EQ(kinds[FLAT_ENTRY], 2);
+  fail |= !EXPECT_EQ(kinds[FLAT_ARG], 2);
+  fail |= !EXPECT_EQ(kinds[FLAT_BIGINT], 1);
+  fail |= !EXPECT_EQ(kinds[FLAT_TERNOP], 1);
+  fail |= !EXPECT_EQ(kinds[FLAT_TFUNC], 1);
+
+  // a function type keeps its return type and params
+  uint32_t fp = ast.extra[ast.data[ast.root].lhs + 2];
+  fail |= !EXPECT_EQ(ast.kind[fp], FLAT_TALIAS);
+  uint32_t tf = ast.data[fp].rhs;
+  fail |= !EXPECT_EQ(ast.kind[tf], FLAT_TFUNC);
+  fail |= !EXPECT_EQ(ast.kind[ast.data[tf].lhs], FLAT_TPRIM);
+  fail |= !EXPECT_EQ(ast.extra[ast.data[tf].rhs], 1);
+
+  // names and decoded strings are copied in
+  uint32_t fn = ast.extra[ast.data[ast.root].lhs + 4];
+  fail |= !EXPECT_EQ(ast.kind[fn], FLAT_FUNC);
+  fail |= !EXPECT_EQ(strcmp(flat_text(&ast, ast.data[fn].lhs), "f"), 0);
+  for (uint32_t i = 1; i < ast.cnt; i++)
+    if (ast.kind[i] == FLAT_STRING)
+      fail |= !EXPECT_EQ(strcmp(flat_text(&ast, ast.data[i].lhs), "a\tb"), 0);
+
+  // the blob maps back in place
+  FILE *tmp = tmpfile();
+  fail |= !EXPECT_EQ(flat_write(&ast, tmp), 0);
+  long size = ftell(tmp);
+  uint64_t *blob = (uint64_t*)malloc(size + 8);
+  rewind(tmp);
+  fail |= !EXPECT_EQ(fread(blob, 1, size, tmp), size);
+  fclose(tmp);
+  FlatAST map;
+  fail |= !EXPECT_EQ(flat_load(&map, blob, size), 0);
+  fail |= !EXPECT_EQ(map.cnt, ast.cnt);
+  fail |= !EXPECT_EQ(memcmp(map.data, ast.data, sizeof(FlatData) * ast.cnt), 0);
+  fail |= !EXPECT_EQ(memcmp(map.kind, ast.kind, ast.cnt), 0);
+  fail |= !EXPECT_EQ(memcmp(map.bytes, ast.bytes, ast.bcnt), 0);
+  fail |= !EXPECT_NE(flat_load(&map, blob, size - 1), 0);
+  flat_free(&map);
+  free(blob);
+
+  flat_free(&ast);
+  znc_free(ctx);
+  return fail;
+}
+
+int test_chain(void) {
+  int fail = 0;
+  ZncContext *ctx = znc_init(false);
+  if (!EXPECT_NE(ctx, NULL)) return 1;
+  uvar n = 300000;
+  char *src = (char*)malloc(n * 16 + 128);
+  if (!src) {
+    znc_free(ctx);
+    return 1;
+  }
+
+  // long chains and deep blocks take no stack
+  char *p = src + sprintf(src, "function int f(int x) { let int y = 1");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, " + 1");
+  p += sprintf(p, "; x =");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, " x **");
+  p += sprintf(p, " 2; ");
+  memset(p, '{', n);
+  memset(p + n, '}', n);
+  strcpy(p + n * 2, " }");
+  ctx->maxdepth = 0;
+  ASTRoot *root = znc_parse(ctx, "<test_chain>", src);
+  if (!EXPECT_NE(root, NULL)) {
+    free(src);
+    znc_free(ctx);
+    return 1;
+  }
+
+  FlatAST ast;
+  if (!EXPECT_EQ(flat_build(&ast, root), 0)) {
+    free(src);
+    znc_free(ctx);
+    return 1;
+  }
+  uvar binops = 0, blocks = 0, after = 0;
+  for (uint32_t i = 1; i < ast.cnt; i++) {
+    if (ast.kind[i] == FLAT_BINOP) {
+      binops++;
+      after += ast.data[i].lhs >= i || ast.data[i].rhs >= i;
+    }
+    blocks += ast.kind[i] == FLAT_BLOCK;
+  }
+  fail |= !EXPECT_EQ(after, 0);
+  fail |= !EXPECT_EQ(binops, n * 2 + 1);
+  fail |= !EXPECT_EQ(blocks, n + 1);
+
+  flat_free(&ast);
+  free(src);
+  znc_free(ctx);
+  return fail;
+}
+
+int test(const char *name) {
+  TEST_REGISTER(test_flat);
+  TEST_REGISTER(test_chain);
+  TEST_RUN(test_flat);
+  TEST_RUN(test_chain);
+  return 0;
+}
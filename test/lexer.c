@@ -1,5 +1,15 @@
 #include "test.h"
 #include "../src/lexer.h"
+#include "../src/keyword.h"
+#include "../src/operator.h"
+#include "../src/parlex.h"
+#include "../src/pipeline.h"
+#include "../src/number.h"
+#include "../src/strlit.h"
+#include "../src/arena.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 int test_tokenizer(void) {
   Lexer lex;
@@ -15,11 +25,11 @@ int test_tokenizer(void) {
     lexer_free(&lex);
     return 1;
   }
-  print_token(tok, "a token\n");
+  print_token(&lex, tok, "a token\n");
 
   // expect eof
   tok = lexer_peek(&lex, 0);
-  if (expect_token(tok, TOKEN_EOF, NULL)) {
+  if (expect_token(&lex, tok, TOKEN_EOF, 0)) {
     lexer_free(&lex);
     return 1;
   }
@@ -28,9 +38,509 @@ int test_tokenizer(void) {
   return 0;
 }
 
+int test_keywords(void) {
+  int fail = 0;
+
+  // exact keywords
+  fail |= !EXPECT_EQ(findkwd("int", 3), KWD_INT);
+  fail |= !EXPECT_EQ(findkwd("function", 8), KWD_FUNCTION);
+  fail |= !EXPECT_EQ(findkwd("ulong", 5), KWD_ULONG);
+  fail |= !EXPECT_EQ(getkwd("else if"), KWD_ELSE);
+
+  // words that only start with a keyword
+  fail |= !EXPECT_EQ(findkwd("integer", 7), KWD_UNK);
+  fail |= !EXPECT_EQ(getkwd("integer"), KWD_UNK);
+  fail |= !EXPECT_EQ(iskwd("letter"), 0);
+  fail |= !EXPECT_EQ(iskwd("while("), 5);
+
+  // the tokenizer should only mark exact matches
+  Lexer lex;
+  lexer_init(&lex, "<test_keywords>", "integer int");
+  Token *tok = lexer_consume(&lex);
+  fail |= !EXPECT_EQ(tok->type, TOKEN_IDENTIFIER);
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_EQ(tok->type, TOKEN_KEYWORD);
+  lexer_free(&lex);
+
+  return fail;
+}
+
+int test_operators(void) {
+  int fail = 0;
+
+  // every operator should map back to itself
+  for (int i = OP_TRP_DOT; i <= OP_DOT; i++) {
+    OperatorType op;
+    uvar len = scanop((char*)OperatorNames[i], &op);
+    fail |= !EXPECT_EQ(op, i);
+    fail |= !EXPECT_EQ(len, strlen(OperatorNames[i]));
+  }
+
+  // longest match wins
+  fail |= !EXPECT_EQ(getop("<<=x"), OP_DBL_LES_EQL);
+  fail |= !EXPECT_EQ(isop("**="), 2);
+  fail |= !EXPECT_EQ(isop("..x"), 1);
+  fail |= !EXPECT_EQ(isop("a"), 0);
+  fail |= !EXPECT_EQ(getop("(+"), OP_UNK);
+
+  return fail;
+}
+
+int test_subkinds(void) {
+  int fail = 0;
+  Lexer lex;
+  lexer_init(&lex, "<test_subkinds>", "while (a <<= 1) {};");
+
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_KEYWORD, KWD_WHILE));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_BRACKET, PUNC_LPAREN));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_IDENTIFIER, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_OPERATOR, OP_DBL_LES_EQL));
+  fail |= !EXPECT_FALSE(cmp_token(lexer_consume(&lex), TOKEN_OPERATOR, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_BRACKET, PUNC_RPAREN));
+
+  // same type, different kind
+  Token *tok = lexer_consume(&lex);
+  fail |= !EXPECT_FALSE(cmp_token(tok, TOKEN_BRACKET, PUNC_RBRACE));
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_BRACKET, PUNC_LBRACE));
+  lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_DELIMETER, PUNC_SEMI));
+
+  lexer_free(&lex);
+  return fail;
+}
+
+int test_skipping(void) {
+  int fail = 0;
+  Lexer lex;
+  lexer_init(&lex, "<test_skipping>",
+      "/* a long header comment, with * and / that do not end it\n"
+      " * spanning over more than one vector block of input text */\n"
+      "\t  // trailing\n"
+      "\tx \"a string with \\\" an escaped quote and \\\\ more text\" y\n"
+      "/* unterminated"
+  );
+
+  uvar line, col;
+  Token *tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_IDENTIFIER, 0));
+  lexer_getloc(&lex, tok->pos, &line, &col);
+  fail |= !EXPECT_EQ(line, 4);
+  fail |= !EXPECT_EQ(col, 9);
+
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_STRING, 0));
+  fail |= !EXPECT_EQ(tok->len, 52);
+  lexer_getloc(&lex, tok->pos, &line, &col);
+  fail |= !EXPECT_EQ(col, 11);
+
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_IDENTIFIER, 0));
+  lexer_getloc(&lex, tok->pos, &line, &col);
+  fail |= !EXPECT_EQ(line, 4);
+  fail |= !EXPECT_EQ(col, 64);
+
+  // the unterminated comment runs to the end
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_EOF, 0));
+  lexer_getloc(&lex, tok->pos, &line, &col);
+  fail |= !EXPECT_EQ(line, 5);
+  fail |= !EXPECT_EQ(col, 16);
+
+  lexer_free(&lex);
+  return fail;
+}
+
+int test_charclass(void) {
+  int fail = 0;
+  Lexer lex;
+  lexer_init(&lex, "<test_charclass>", "_a1 9_0;x\xc3\xa9");
+
+  Token *tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_IDENTIFIER, 0));
+  fail |= !EXPECT_EQ(tok->len, 3);
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_INTEGER, 0));
+  fail |= !EXPECT_EQ(tok->len, 3);
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_DELIMETER, PUNC_SEMI));
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_IDENTIFIER, 0));
+  fail |= !EXPECT_EQ(tok->len, 1);
+
+  // non-ascii bytes are not identifier chars
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_ERROR, 0));
+
+  lexer_free(&lex);
+  return fail;
+}
+
+int test_window(void) {
+  int fail = 0;
+
+  // a long run of tokens
+  char src[4096];
+  src[0] = '\0';
+  for (int i = 0; i < 300; i++)
+    strcat(src, "a += 1; ");
+
+  Lexer lex;
+  lexer_init(&lex, "<test_window>", src);
+  fail |= !EXPECT_EQ(lexer_setwindow(&lex, 20), 0);
+  fail |= !EXPECT_EQ(lex.talloc, 32);
+
+  uvar cnt = 0;
+  Token *tok;
+  while ((tok = lexer_consume(&lex))->type != TOKEN_EOF) {
+    if (cnt % 4 == 1 && !EXPECT_TRUE(cmp_token(tok, TOKEN_OPERATOR, OP_PLS_EQL)))
+      fail = 1;
+    // lookahead and lookbehind stay inside the window
+    fail |= !EXPECT_NE(lexer_peek(&lex, 2), NULL);
+    fail |= !EXPECT_EQ(lexer_peek(&lex, 0), tok);
+    cnt++;
+  }
+  fail |= !EXPECT_EQ(cnt, 1200);
+
+  // the storage did not grow, old tokens are gone
+  fail |= !EXPECT_EQ(lex.talloc, 32);
+  fail |= !EXPECT_EQ(lexer_peek(&lex, -100), NULL);
+
+  lexer_free(&lex);
+  return fail;
+}
+
+int test_compact(void) {
+  int fail = 0;
+  fail |= !EXPECT_EQ(sizeof(Token), 8);
+
+  // a string literal too long for the packed length
+  uvar slen = 70000;
+  char *src = (char*)malloc(slen + 8);
+  if (!src) return 1;
+  src[0] = '"';
+  memset(src + 1, 'x', slen - 2);
+  strcpy(src + slen - 1, "\" abc");
+
+  Lexer lex;
+  lexer_init(&lex, "<test_compact>", src);
+  Token *tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_STRING, 0));
+  fail |= !EXPECT_EQ(tok->len, TOKEN_LONGLEN);
+  fail |= !EXPECT_EQ(lexer_toklen(&lex, tok), slen);
+  fail |= !EXPECT_EQ(lexer_spanat(toktext(&lex, tok)), slen);
+
+  tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_IDENTIFIER, 0));
+  fail |= !EXPECT_EQ(tok->pos, slen + 1);
+  fail |= !EXPECT_EQ(lexer_toklen(&lex, tok), 3);
+  fail |= !EXPECT_EQ(strncmp(toktext(&lex, tok), "abc", 3), 0);
+
+  lexer_free(&lex);
+  free(src);
+  return fail;
+}
+
+int test_batch(void) {
+  int fail = 0;
+  char *src = "let x = (a + 1) * b; // done\n";
+
+  // the lazy lexer gives the reference stream
+  Lexer ref;
+  lexer_init(&ref, "<test_batch>", src);
+
+  Lexer lex;
+  lexer_init(&lex, "<test_batch>", src);
+  fail |= !EXPECT_EQ(lexer_tokenize_all(&lex), 0);
+  fail |= !EXPECT_TRUE(lex.eof);
+  fail |= !EXPECT_EQ(lex.tcnt, 12);
+  // reserved once, from the input size
+  fail |= !EXPECT_GE(lex.talloc, lex.tcnt);
+
+  Token *a, *b;
+  do {
+    a = lexer_consume(&ref);
+    b = lexer_consume(&lex);
+    fail |= !EXPECT_EQ(a->pos, b->pos);
+    fail |= !EXPECT_EQ(a->type, b->type);
+    fail |= !EXPECT_EQ(a->sub, b->sub);
+  } while (a->type != TOKEN_EOF && !fail);
+  fail |= !EXPECT_EQ(b->type, TOKEN_EOF);
+
+  // not available on a token window
+  Lexer win;
+  lexer_init(&win, "<test_batch>", src);
+  lexer_setwindow(&win, LEXER_MINWINDOW);
+  fail |= !EXPECT_NE(lexer_tokenize_all(&win), 0);
+
+  lexer_free(&win);
+  lexer_free(&lex);
+  lexer_free(&ref);
+  return fail;
+}
+
+int test_parallel(void) {
+  int fail = 0;
+
+  // a few chunks worth of code, with a block comment that spans a cut
+  // and code-like text inside it
+  const char *line = "let x = foo(a, \"b\") + 12; // c\n";
+  uvar llen = strlen(line);
+  uvar cnt = PARLEX_MINCHUNK * 3 / llen;
+  char *src = (char*)malloc(llen * cnt + 1);
+  if (!src) return 1;
+  for (uvar i = 0; i < cnt; i++)
+    memcpy(src + i * llen, line, llen);
+  src[llen * cnt] = '\0';
+  src[llen * (cnt / 3 - 100)] = '/';
+  src[llen * (cnt / 3 - 100) + 1] = '*';
+  src[llen * (cnt / 3 + 100)] = '*';
+  src[llen * (cnt / 3 + 100) + 1] = '/';
+
+  Lexer ref;
+  lexer_init(&ref, "<test_parallel>", src);
+  lexer_tokenize_all(&ref);
+
+  Lexer lex;
+  lexer_init(&lex, "<test_parallel>", src);
+  fail |= !EXPECT_EQ(lexer_tokenize_par(&lex, 4), 0);
+  fail |= !EXPECT_EQ(lex.tcnt, ref.tcnt);
+  fail |= !EXPECT_EQ(memcmp(lex.toks, ref.toks, sizeof(Token) * ref.tcnt), 0);
+  lexer_free(&lex);
+
+  // a lexical error far from the start still stops the stream there
+  src[llen * (cnt - 10)] = '@';
+  lexer_init(&lex, "<test_parallel>", src);
+  lex.quiet = true;
+  fail |= !EXPECT_EQ(lexer_tokenize_par(&lex, 4), 0);
+  fail |= !EXPECT_TRUE(cmp_token(&lex.toks[lex.tcnt - 1], TOKEN_ERROR, 0));
+  fail |= !EXPECT_EQ(lex.toks[lex.tcnt - 1].pos, llen * (cnt - 10));
+
+  lexer_free(&lex);
+  lexer_free(&ref);
+  free(src);
+  return fail;
+}
+
+int test_pipeline(void) {
+  int fail = 0;
+
+  // more batches than the ring holds
+  const char *line = "fn(a[1], \"x\"); /* c */\n";
+  uvar llen = strlen(line);
+  uvar cnt = PIPE_BATCH * PIPE_SLOTS / 4;
+  char *src = (char*)malloc(llen * cnt + 4);
+  if (!src) return 1;
+  for (uvar i = 0; i < cnt; i++)
+    memcpy(src + i * llen, line, llen);
+  strcpy(src + llen * cnt, "a @");
+
+  Lexer ref;
+  lexer_init(&ref, "<test_pipeline>", src);
+  ref.quiet = true;
+  lexer_tokenize_all(&ref);
+
+  Lexer lex;
+  lexer_init(&lex, "<test_pipeline>", src);
+  lex.quiet = true;
+  fail |= !EXPECT_EQ(lexer_pipeline(&lex), 0);
+
+  // the same stream, up to the error token
+  Token *a, *b;
+  uvar i = 0;
+  do {
+    a = &ref.toks[i++];
+    b = lexer_consume(&lex);
+    fail |= !EXPECT_EQ(a->pos, b->pos);
+    fail |= !EXPECT_EQ(a->type, b->type);
+    fail |= !EXPECT_EQ(a->sub, b->sub);
+  } while (i < ref.tcnt && !fail);
+  fail |= !EXPECT_TRUE(cmp_token(b, TOKEN_ERROR, 0));
+  fail |= !EXPECT_TRUE(lex.eof);
+  lexer_free(&lex);
+
+  // stopping early joins a lexer thread that waits for room
+  lexer_init(&lex, "<test_pipeline>", src);
+  fail |= !EXPECT_EQ(lexer_pipeline(&lex), 0);
+  fail |= !EXPECT_NE(lexer_consume(&lex), NULL);
+  lexer_free(&lex);
+  fail |= !EXPECT_EQ(lex.pipe, NULL);
+
+  lexer_free(&ref);
+  free(src);
+  return fail;
+}
+
+int test_float(void) {
+  int fail = 0;
+
+  Lexer lex;
+  lexer_init(&lex, "<test_float>", "0.5 .25 12. 3 x.y 0.0 01.5");
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_FLOAT, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_FLOAT, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_FLOAT, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_IDENTIFIER, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_OPERATOR, OP_DOT));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_IDENTIFIER, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_FLOAT, 0));
+  // only 0 may start the integer part with a zero
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, 0));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_FLOAT, 0));
+  lexer_free(&lex);
+
+  // exact values, ties and the slow path
+  fail |= !EXPECT_EQ(num_float("0.1", 3), 0.1);
+  fail |= !EXPECT_EQ(num_float("3.14159", 7), 3.14159);
+  fail |= !EXPECT_EQ(num_float(".5", 2), 0.5);
+  fail |= !EXPECT_EQ(num_float("0.", 2), 0.0);
+  fail |= !EXPECT_EQ(num_float("9007199254740993.", 17), 9007199254740992.0);
+  fail |= !EXPECT_EQ(num_float("9007199254740993.0000000000000000001", 36), 9007199254740994.0);
+  fail |= !EXPECT_EQ(num_float("123456789012345678901234567890.", 31), 123456789012345678901234567890.0);
+  fail |= !EXPECT_EQ(num_float("0.1000000000000000055511151231257827021181583404541015625", 57), 0.1);
+  return fail;
+}
+
+int test_intlit(void) {
+  int fail = 0;
+
+  Lexer lex;
+  lexer_init(&lex, "<test_intlit>", "0 1_000 0x1F_ff 0b101 0o17 017 0x");
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, INTL_DEC));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, INTL_DEC));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, INTL_HEX));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, INTL_BIN));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, INTL_OCT));
+  fail |= !EXPECT_TRUE(cmp_token(lexer_consume(&lex), TOKEN_INTEGER, INTL_OCT));
+  // a prefix without digits
+  lex.quiet = true;
+  Token *tok = lexer_consume(&lex);
+  fail |= !EXPECT_TRUE(cmp_token(tok, TOKEN_ERROR, 0));
+  fail |= !EXPECT_EQ(lexer_toklen(&lex, tok), 2);
+  lexer_free(&lex);
+
+  uint64_t val = 0;
+  fail |= !EXPECT_EQ(num_int("1_234_567_890_123", 17, INTL_DEC, &val), 0);
+  fail |= !EXPECT_EQ(val, 1234567890123);
+  fail |= !EXPECT_EQ(num_int("18446744073709551615", 20, INTL_DEC, &val), 0);
+  fail |= !EXPECT_EQ(val, UINT64_MAX);
+  fail |= !EXPECT_EQ(num_int("0xdead_BEEF", 11, INTL_HEX, &val), 0);
+  fail |= !EXPECT_EQ(val, 0xdeadbeef);
+  fail |= !EXPECT_EQ(num_int("0b1011", 6, INTL_BIN, &val), 0);
+  fail |= !EXPECT_EQ(val, 11);
+  fail |= !EXPECT_EQ(num_int("017", 3, INTL_OCT, &val), 0);
+  fail |= !EXPECT_EQ(val, 15);
+  fail |= !EXPECT_EQ(num_int("0o17", 4, INTL_OCT, &val), 0);
+  fail |= !EXPECT_EQ(val, 15);
+
+  // 2^64 overflows into limbs
+  const char *big = "18446744073709551616";
+  fail |= !EXPECT_EQ(num_int(big, 20, INTL_DEC, &val), 1);
+  uint32_t limbs[16];
+  fail |= !EXPECT_GE(16, num_intlimbs(20, INTL_DEC));
+  fail |= !EXPECT_EQ(num_intbig(big, 20, INTL_DEC, limbs), 3);
+  fail |= !EXPECT_EQ(limbs[0], 0);
+  fail |= !EXPECT_EQ(limbs[1], 0);
+  fail |= !EXPECT_EQ(limbs[2], 1);
+  return fail;
+}
+
+int test_strlit(void) {
+  int fail = 0;
+  Arena *arena = arena_init(ARENA_MINSIZE);
+  if (!arena) return 1;
+  char *out;
+  uvar olen, err;
+
+  // no escapes, a view into the source
+  char plain[] = "\"caf\xc3\xa9 au lait\"";
+  fail |= !EXPECT_EQ(str_decode(plain, strlen(plain), arena, &out, &olen, &err), STR_OK);
+  fail |= !EXPECT_EQ(out, plain + 1);
+  fail |= !EXPECT_EQ(olen, strlen(plain) - 2);
+
+  char esc[] = "\"a\\tb\\u00e9\\u{1F600}\\101\\477\\e\\\"\"";
+  const char want[] = "a\tb\xc3\xa9\xf0\x9f\x98\x80" "A" "\047" "7\033\"";
+  fail |= !EXPECT_EQ(str_decode(esc, strlen(esc), arena, &out, &olen, &err), STR_OK);
+  fail |= !EXPECT_EQ(olen, sizeof(want) - 1);
+  fail |= !EXPECT_EQ(memcmp(out, want, sizeof(want) - 1), 0);
+
+  // malformed escapes and bytes
+  const char *bad[] = {
+    "\"ab\\q\"", "\"ab\\u12\"", "\"ab\\u{110000}\"", "\"ab\\uD800\"",
+    "\"ab\\u{}\"", "\"ab\xc0\x80\"", "\"ab\xed\xa0\x80\"", "\"ab\xe2\x82\"",
+  };
+  for (uvar i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    char buf[32];
+    strcpy(buf, bad[i]);
+    fail |= !EXPECT_NE(str_decode(buf, strlen(buf), arena, &out, &olen, &err), STR_OK);
+    fail |= !EXPECT_EQ(err, 3);
+  }
+
+  arena_free(arena);
+  return fail;
+}
+
+int test_srcmgr(void) {
+  int fail = 0;
+  Lexer a, b;
+  lexer_init(&a, "<test_srcmgr_a>", "let x;\n\tlet y;");
+  lexer_init(&b, "<test_srcmgr_b>", "fn f() {}");
+
+  // the ranges of the buffers do not overlap
+  Token *ta = lexer_peek(&a, 5);
+  Token *tb = lexer_peek(&b, 1);
+  SrcLoc la = tokloc(&a, ta), lb = tokloc(&b, tb);
+  fail |= !EXPECT_NE(la, SRCLOC_NONE);
+  fail |= !EXPECT_TRUE(lb > la);
+  fail |= !EXPECT_EQ(src_find(la), a.src);
+  fail |= !EXPECT_EQ(src_find(lb), b.src);
+  fail |= !EXPECT_EQ(src_find(SRCLOC_NONE), NULL);
+
+  // 'y' is past a tab on the second line
+  SrcBuffer *buf = NULL;
+  uvar line = 0, col = 0;
+  fail |= !EXPECT_EQ(src_getloc(la, &buf, &line, &col), 0);
+  fail |= !EXPECT_EQ(buf, a.src);
+  fail |= !EXPECT_EQ(line, 2);
+  fail |= !EXPECT_EQ(col, 13);
+  fail |= !EXPECT_EQ(lexer_spanat(toktext(&a, ta)), 1);
+
+  // locations outlive the lexer
+  lexer_free(&a);
+  fail |= !EXPECT_EQ(src_getloc(lb, &buf, &line, &col), 0);
+  fail |= !EXPECT_EQ(strcmp(buf->name, "<test_srcmgr_b>"), 0);
+  lexer_free(&b);
+  return fail;
+}
+
 int test(const char *name) {
   TEST_REGISTER(test_tokenizer);
+  TEST_REGISTER(test_keywords);
+  TEST_REGISTER(test_operators);
+  TEST_REGISTER(test_subkinds);
+  TEST_REGISTER(test_skipping);
+  TEST_REGISTER(test_charclass);
+  TEST_REGISTER(test_window);
+  TEST_REGISTER(test_compact);
+  TEST_REGISTER(test_batch);
+  TEST_REGISTER(test_parallel);
+  TEST_REGISTER(test_pipeline);
+  TEST_REGISTER(test_float);
+  TEST_REGISTER(test_intlit);
+  TEST_REGISTER(test_strlit);
+  TEST_REGISTER(test_srcmgr);
   TEST_RUN(test_tokenizer);
+  TEST_RUN(test_keywords);
+  TEST_RUN(test_operators);
+  TEST_RUN(test_subkinds);
+  TEST_RUN(test_skipping);
+  TEST_RUN(test_charclass);
+  TEST_RUN(test_window);
+  TEST_RUN(test_compact);
+  TEST_RUN(test_batch);
+  TEST_RUN(test_parallel);
+  TEST_RUN(test_pipeline);
+  TEST_RUN(test_float);
+  TEST_RUN(test_intlit);
+  TEST_RUN(test_strlit);
+  TEST_RUN(test_srcmgr);
   return 0;
 }
 
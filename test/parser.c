@@ -0,0 +1,278 @@
+#include "test.h"
+#include "../src/lexer.h"
+#include "../src/operator.h"
+#include "../src/arena.h"
+#include "../src/ast.h"
+#include "../src/znc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int test_checkpoint(void) {
+  int fail = 0;
+  Arena *arena = arena_init(ARENA_MINSIZE);
+  if (!arena) return 1;
+  Lexer lex;
+  lexer_init(&lex, "<test_checkpoint>", "a + (b; c");
+
+  // a failed attempt gives back its tokens and nodes, quietly
+  ArenaBlock *curr = arena->curr;
+  uvar used = curr->used;
+  ParseCheckpoint cp = parse_checkpoint(&lex, arena);
+  ASTExpr *expr = parse_expr(&lex, arena);
+  fail |= !EXPECT_EQ(expr, NULL);
+  fail |= !EXPECT_NE(lex.pind, 0);
+  parse_rollback(&lex, arena, &cp);
+  fail |= !EXPECT_EQ(lex.pind, 0);
+  fail |= !EXPECT_EQ(lex.mute, 0);
+  fail |= !EXPECT_EQ(arena->curr, curr);
+  fail |= !EXPECT_EQ(curr->used, used);
+
+  // blocks added during the attempt are released too, the regular ones
+  // are kept free for reuse
+  cp = parse_checkpoint(&lex, arena);
+  for (uvar i = 0; i < ARENA_MINSIZE / 64 + 1; i++)
+    arena_reqm(arena, 64);
+  arena_reqm(arena, ARENA_MINSIZE);
+  fail |= !EXPECT_NE(arena->curr, curr);
+  fail |= !EXPECT_NE(arena->big, NULL);
+  parse_rollback(&lex, arena, &cp);
+  fail |= !EXPECT_EQ(arena->curr, curr);
+  fail |= !EXPECT_EQ(arena->big, NULL);
+  fail |= !EXPECT_EQ(curr->used, used);
+
+  // a successful one keeps them
+  cp = parse_checkpoint(&lex, arena);
+  expr = parse_identifier(&lex, arena);
+  parse_commit(&lex, &cp);
+  fail |= !EXPECT_NE(expr, NULL);
+  fail |= !EXPECT_EQ(lex.pind, 1);
+  fail |= !EXPECT_TRUE(curr->used > used);
+
+  lexer_free(&lex);
+  arena_free(arena);
+  return fail;
+}
+
+int test_infix(void) {
+  int fail = 0;
+  Arena *arena = arena_init(ARENA_MINSIZE);
+  if (!arena) return 1;
+  Lexer lex;
+  lexer_init(&lex, "<test_infix>", "a = b = c - d - e * f ** g ** h, i");
+
+  // a = (b = (((c - d) - (e * (f ** (g ** h))))), i
+  ASTExpr *e = parse_expr(&lex, arena);
+  if (!EXPECT_NE(e, NULL)) {
+    lexer_free(&lex);
+    arena_free(arena);
+    return 1;
+  }
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_CMM);
+  e = e->val.binop.lhs;
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_EQL);
+  fail |= !EXPECT_EQ(e->val.binop.lhs->type, AST_EXPR_IDENTIFIER);
+  e = e->val.binop.rhs;
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_EQL);
+  e = e->val.binop.rhs;
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_DSH);
+  fail |= !EXPECT_EQ(e->val.binop.lhs->val.binop.op, OP_DSH);
+  e = e->val.binop.rhs;
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_AST);
+  e = e->val.binop.rhs;
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_DBL_AST);
+  fail |= !EXPECT_EQ(e->val.binop.lhs->type, AST_EXPR_IDENTIFIER);
+  e = e->val.binop.rhs;
+  fail |= !EXPECT_EQ(e->val.binop.op, OP_DBL_AST);
+  lexer_free(&lex);
+
+  // long right-associative runs are nested the same way
+  uvar n = 100000;
+  char *src = (char*)malloc(n * 5 + 2);
+  if (!src) {
+    arena_free(arena);
+    return 1;
+  }
+  for (uvar i = 0; i < n; i++)
+    memcpy(src + i * 5, "a ** ", 5);
+  strcpy(src + n * 5, "b");
+  lexer_init(&lex, "<test_infix>", src);
+  e = parse_expr(&lex, arena);
+  uvar cnt = 0;
+  while (e && e->type == AST_EXPR_BINOP && e->val.binop.op == OP_DBL_AST &&
+         e->val.binop.lhs->type == AST_EXPR_IDENTIFIER) {
+    e = e->val.binop.rhs;
+    cnt++;
+  }
+  fail |= !EXPECT_EQ(cnt, n);
+  fail |= !EXPECT_NE(e, NULL);
+
+  free(src);
+  lexer_free(&lex);
+  arena_free(arena);
+  return fail;
+}
+
+int test_nesting(void) {
+  int fail = 0;
+  ZncContext *ctx = znc_init(false);
+  if (!EXPECT_NE(ctx, NULL)) return 1;
+  ctx->quiet = true;
+  uvar n = 100000;
+  char *src = (char*)malloc(n * 32 + 64);
+  if (!src) {
+    znc_free(ctx);
+    return 1;
+  }
+
+  // long chains take no stack
+  char *p = src + sprintf(src, "function int f(int x) { if (x) x;");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, " else if (x) x;");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, " x =");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, " x **");
+  p += sprintf(p, " 2; return ");
+  memset(p, '-', n);
+  p += n;
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, "g(x).a");
+  sprintf(p, "; }");
+  fail |= !EXPECT_NE(znc_parse(ctx, "<test_nesting_a>", src), NULL);
+
+  // nesting is only bound by the limit
+  p = src + sprintf(src, "function int f(int x) ");
+  memset(p, '{', n);
+  memset(p + n, '}', n);
+  p[n * 2] = '\0';
+  fail |= !EXPECT_EQ(znc_parse(ctx, "<test_nesting_b>", src), NULL);
+  fail |= !EXPECT_EQ(ctx->lex.depth, 0);
+  ctx->maxdepth = 0;
+  fail |= !EXPECT_NE(znc_parse(ctx, "<test_nesting_b>", src), NULL);
+
+  // what the parser recurses into stays bound without a limit
+  p = src + sprintf(src, "function int f(int x) { return ");
+  memset(p, '(', n);
+  p[n] = 'x';
+  memset(p + n + 1, ')', n);
+  strcpy(p + n * 2 + 1, "; }");
+  fail |= !EXPECT_EQ(znc_parse(ctx, "<test_nesting_c>", src), NULL);
+  fail |= !EXPECT_EQ(ctx->lex.rdepth, 0);
+  p = src + sprintf(src, "type t = ");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, "function(");
+  p += sprintf(p, "int");
+  for (uvar i = 0; i < n; i++)
+    p += sprintf(p, ")()");
+  sprintf(p, ";");
+  fail |= !EXPECT_EQ(znc_parse(ctx, "<test_nesting_c>", src), NULL);
+
+  ctx->maxdepth = 16;
+  fail |= !EXPECT_EQ(znc_parse(ctx, "<test_nesting_d>",
+      "function int f(int x) { return ((((((((((((((((x)))))))))))))))); }"), NULL);
+
+  free(src);
+  znc_free(ctx);
+  return fail;
+}
+
+int test_recovery(void) {
+  int fail = 0;
+  Arena *arena = arena_init(ARENA_MINSIZE);
+  if (!arena) return 1;
+  Lexer lex;
+  lexer_init(&lex, "<test_recovery>",
+      "type ids = int[;\n"
+      "function int f(int x) {\n"
+      "  x = (x + ;\n"
+      "  while (x { x--; }\n"
+      "  if (x) { return -; } else x = 1;\n"
+      "  return x;\n"
+      "}\n"
+      "function int g( { return 1; }\n"
+      "function int h() { return 0; }\n");
+  lex.quiet = true;
+
+  // every error is reported, the broken parts become error nodes
+  ASTRoot *root = parse_root(&lex, arena);
+  if (!EXPECT_NE(root, NULL)) {
+    lexer_free(&lex);
+    arena_free(arena);
+    return 1;
+  }
+  fail |= !EXPECT_EQ(lex.nerrs, 5);
+  ASTDecl *decl = root->head;
+  fail |= !EXPECT_EQ(decl->type, AST_ROOT_ERROR);
+  decl = decl->next;
+  fail |= !EXPECT_EQ(decl->type, AST_ROOT_FUNCDEF);
+  ASTStm *stm = decl->val.func->code->head;
+  fail |= !EXPECT_EQ(stm->type, AST_STM_ERROR);
+  fail |= !EXPECT_EQ(stm->next->type, AST_STM_ERROR);
+  stm = stm->next->next;
+  fail |= !EXPECT_EQ(stm->type, AST_STM_IFELSE);
+  fail |= !EXPECT_EQ(stm->val.ifels.code->val.blck->head->type, AST_STM_ERROR);
+  fail |= !EXPECT_NE(stm->val.ifels.elsec, NULL);
+  fail |= !EXPECT_EQ(stm->next->type, AST_STM_RETURN);
+  decl = decl->next;
+  fail |= !EXPECT_EQ(decl->type, AST_ROOT_ERROR);
+  fail |= !EXPECT_EQ(decl->next->type, AST_ROOT_FUNCDEF);
+  fail |= !EXPECT_EQ(decl->next, root->tail);
+
+  // and the parse as a whole fails
+  lexer_free(&lex);
+  lexer_init(&lex, "<test_recovery>", "function int f() { x = ; y = ; z = ; }");
+  lex.quiet = true;
+  lex.maxerrs = 2;
+  fail |= !EXPECT_EQ(parse(&lex, arena), NULL);
+  fail |= !EXPECT_EQ(lex.nerrs, 2);
+
+  lexer_free(&lex);
+  arena_free(arena);
+  return fail;
+}
+
+int test_context(void) {
+  int fail = 0;
+  ZncContext *ctx = znc_init(false);
+  if (!EXPECT_NE(ctx, NULL)) return 1;
+  ctx->quiet = true;
+
+  char a[] = "function int f(int x) { return x * 2 + 1; }";
+  char b[] = "function int g(int y) { return y - 3 / 2; }";
+  fail |= !EXPECT_NE(znc_parse(ctx, "<test_context_a>", a), NULL);
+  Token *toks = ctx->lex.toks;
+  ArenaStats st;
+  arena_stats(ctx->arena, &st);
+  uvar footprint = st.footprint;
+
+  // the next input of the same size reuses everything
+  fail |= !EXPECT_NE(znc_parse(ctx, "<test_context_b>", b), NULL);
+  fail |= !EXPECT_EQ(ctx->lex.toks, toks);
+  arena_stats(ctx->arena, &st);
+  fail |= !EXPECT_EQ(st.footprint, footprint);
+  fail |= !EXPECT_EQ(src_find(tokloc(&ctx->lex, ctx->lex.toks))->name, "<test_context_b>");
+
+  // errors only fail the one compilation
+  char c[] = "function int h( { }";
+  fail |= !EXPECT_EQ(znc_parse(ctx, "<test_context_c>", c), NULL);
+  fail |= !EXPECT_NE(znc_parse(ctx, "<test_context_a>", a), NULL);
+
+  znc_free(ctx);
+  return fail;
+}
+
+int test(const char *name) {
+  TEST_REGISTER(test_checkpoint);
+  TEST_REGISTER(test_infix);
+  TEST_REGISTER(test_nesting);
+  TEST_REGISTER(test_recovery);
+  TEST_REGISTER(test_context);
+  TEST_RUN(test_checkpoint);
+  TEST_RUN(test_infix);
+  TEST_RUN(test_nesting);
+  TEST_RUN(test_recovery);
+  TEST_RUN(test_context);
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "test.h"
+#include "../src/scan.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef char *(*ScanFn)(char*);
+
+static const ScanFn Scanners[] = {
+  scan_space, scan_line, scan_cmtend, scan_strbody, scan_strrun,
+};
+
+#define NSCANNERS (sizeof(Scanners) / sizeof(Scanners[0]))
+
+// length and count of the test strings
+#define SCAN_LEN 96
+#define SCAN_CNT 64
+
+// fill buf with strings that have every interesting char at random places,
+// the first ones are mostly spaces so the space scanner gets far
+static void scan_fill(char *buf) {
+  static const char chars[] = " \t\r\n*/\"\\a0\x80\xc3";
+  srand(42);
+  for (int i = 0; i < SCAN_CNT; i++) {
+    char *s = buf + i * (SCAN_LEN + 1);
+    for (int j = 0; j < SCAN_LEN; j++) {
+      int r = rand() % (i < SCAN_CNT / 2 ? 64 : 16);
+      s[j] = r < (int)sizeof(chars) - 1 ? chars[r] : (i < SCAN_CNT / 2 ? ' ' : 'x');
+    }
+    s[rand() % (SCAN_LEN + 1)] = '\0';
+    s[SCAN_LEN] = '\0';
+  }
+}
+
+// offsets found by every scanner from every start in buf
+static void scan_all(char *buf, ptrdiff_t *out) {
+  for (int i = 0; i < SCAN_CNT; i++) {
+    char *s = buf + i * (SCAN_LEN + 1);
+    for (int j = 0; j <= SCAN_LEN; j++)
+      for (size_t k = 0; k < NSCANNERS; k++)
+        *out++ = Scanners[k](s + j) - s;
+  }
+}
+
+int test_kernels(void) {
+  int fail = 0;
+  size_t n = (size_t)SCAN_CNT * (SCAN_LEN + 1) * NSCANNERS;
+  char *buf = (char*)malloc(SCAN_CNT * (SCAN_LEN + 1));
+  ptrdiff_t *want = (ptrdiff_t*)malloc(sizeof(ptrdiff_t) * n);
+  ptrdiff_t *got = (ptrdiff_t*)malloc(sizeof(ptrdiff_t) * n);
+  if (!buf || !want || !got) {
+    free(buf);
+    free(want);
+    free(got);
+    return 1;
+  }
+  scan_fill(buf);
+
+  // the scalar kernel is the reference
+  fail |= !EXPECT_EQ(scan_setkernel("scalar"), 0);
+  fail |= !EXPECT_EQ(strcmp(scan_kernel(), "scalar"), 0);
+  scan_all(buf, want);
+
+  // the vector kernels the cpu can run must agree with it
+  const char *kernels[] = { "sse2", "avx2" };
+  for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+    if (scan_setkernel(kernels[i]))
+      continue;
+    scan_all(buf, got);
+    fail |= !EXPECT_EQ(memcmp(want, got, sizeof(ptrdiff_t) * n), 0);
+  }
+
+  fail |= !EXPECT_NE(scan_setkernel("none"), 0);
+  fail |= !EXPECT_EQ(scan_setkernel(NULL), 0);
+  free(buf);
+  free(want);
+  free(got);
+  return fail;
+}
+
+int test(const char *name) {
+  TEST_REGISTER(test_kernels);
+  TEST_RUN(test_kernels);
+  return 0;
+}